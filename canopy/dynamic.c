@@ -1,5 +1,8 @@
-#include <err.h>
-#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdlib.h>
+#include "app.h"
+#include "fractals.h"
+#include "present.h"
 
 #define MIN(a, b) ( ( (a) < (b) ) ? (a) : (b) )
 #define MAX(a, b) ( ( (a) > (b) ) ? (a) : (b) )
@@ -13,149 +16,70 @@ const int INIT_HEIGHT = 400;
 const int INIT_MOUSE_X = INIT_WIDTH / 10;
 const int INIT_MOUSE_Y = INIT_HEIGHT;
 
-// Ratio used to reduce the length of a segment.
-const double RATIO = 0.7;
-
-// Recursive function that draws the fractal canopy.
-//
-// renderer: Renderer to draw on.
-// x: Abscissa of the starting point of the segments.
-// y: Ordinate of the starting point of the segments.
-// len: Length of the segments.
-// a: Angle use to rotate the segments.
-// level: Recursion level (0 = first iteration).
-// top_level: Maximum level for recursion.
-// step_angle: Angle used to rotate the left- and right-angled segments.
-void v(SDL_Renderer* renderer, int x, int y, double len, double a, int level, int top_level, double step_angle)
+// Position of the mouse cursor.
+struct mouse
 {
-    if (level == 0)
-    {
-        int y1 = y - len;
-        SDL_RenderDrawLine(renderer, x, y, x, y1);
-        v(renderer, x, y1, len, a, level+1, top_level, step_angle);
-    }
-    else if (level <= top_level)
-    {
-        // Getting locations
-        int x1 = x - len * sin(a + step_angle);
-        int y1 = y - len * cos(a + step_angle);
-        int x2 = x - len * sin(a - step_angle);
-        int y2 = y - len * cos(a - step_angle);
-
-        // Drawing stuff
-        SDL_RenderDrawLine(renderer, x, y, x1, y1);
-        SDL_RenderDrawLine(renderer, x, y, x2, y2);
-
-        // Recursion call
-        v(renderer, x1, y1, len * RATIO, a + step_angle, level+1, top_level, step_angle);
-        v(renderer, x2, y2, len * RATIO, a - step_angle, level+1, top_level, step_angle);
-    }
-}
+    int x;
+    int y;
+};
 
-// Initializes the renderer, draws the fractal canopy and updates the display.
+// State of the app: only the events change it, the frames are drawn from
+// snapshots of it.
+struct mouse MOUSE = { INIT_MOUSE_X, INIT_MOUSE_Y };
+
+// Segments of the frame.
+struct segments SEGMENTS;
+
+// Draws the fractal canopy, shaped by the position of the mouse.
 //
 // renderer: Renderer to draw on.
+// surface: Unused (the canopy is drawn with the renderer).
 // w: Current width of the window.
 // h: Current height of the window.
-// mouse_x: Abscissa of the mouse cursor.
-// mouse_y: Ordinate of the mouse cursor.
-void draw(SDL_Renderer* renderer, int w, int h, int mouse_x, int mouse_y)
+// state: Position of the mouse (snapshot of MOUSE).
+void draw(SDL_Renderer* renderer, SDL_Surface * surface, int w, int h, const void * state)
 {
+    (void) surface;
 
     // If the width or the height is too small, we do not draw anything.
     if (w < 20 || h < 20)
         return;
 
-    // Fill BG with black
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    // Set color to white
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-
     // Getting top_level and step_angle
-    int top_level = DIM(mouse_y / (h/11), 0, 10);
-    double step_angle = DIM(M_PI / (2.00 + mouse_x / (w / 18.0)), M_PI / 20, M_PI / 2);
-    // Call recursive function to draw
-    v(renderer, w/2, h, (double) h/4, 0, 0, top_level, step_angle);
-
-    SDL_RenderPresent(renderer);
+    const struct mouse * mouse = state;
+    int top_level = DIM(mouse->y / (h/11), 0, 10);
+    double step_angle = DIM(M_PI / (2.00 + mouse->x / (w / 18.0)), M_PI / 20, M_PI / 2);
+
+    // Generates and draws the fractal canopy.
+    segments_clear(&SEGMENTS);
+    canopy(&SEGMENTS, w/2, h, (double) h/4, (double) h/4, top_level, step_angle);
+    draw_segments(renderer, &SEGMENTS);
 }
 
-// Event loop that calls the relevant event handler.
-//
-// renderer: Renderer to draw on.
-void event_loop(SDL_Renderer* renderer)
+// If the mouse is moving, updates the position of the cursor.
+int event(const SDL_Event * event, int w, int h, void * state)
 {
-    // Width and height of the window.
-    int w = INIT_WIDTH;
-    int h = INIT_HEIGHT;
-
-    // (Fake) position of the mouse cursor.
-    int mouse_x = INIT_MOUSE_X;
-    int mouse_y = INIT_MOUSE_Y;
-
-    // Draws the fractal canopy (first draw).
-    draw(renderer, w, h, mouse_x, mouse_y);
-
-    // Creates a variable to get the events.
-    SDL_Event event;
-
-    while (1)
-    {
-        // Waits for an event.
-        SDL_WaitEvent(&event);
-
-        switch (event.type)
-        {
-            // If the "quit" button is pushed, ends the event loop.
-            case SDL_QUIT:
-                return;
-
-            // If the window is resized, updates and redraws the diagonals.
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    w = event.window.data1;
-                    h = event.window.data2;
-                    draw(renderer, w, h, mouse_x, mouse_y);
-                }
-                break;
-
-            // If the mouse is moving, updates the position of the cursor.
-            case SDL_MOUSEMOTION:
-                mouse_x = event.motion.x;
-                mouse_y = event.motion.y;
-                draw(renderer, w, h, mouse_x, mouse_y);
-                break;
-        }
-    }
+    (void) w;
+    (void) h;
+
+    if (event->type != SDL_MOUSEMOTION)
+        return 0;
+
+    struct mouse * mouse = state;
+    mouse->x = event->motion.x;
+    mouse->y = event->motion.y;
+    return 1;
 }
 
-int main()
+int main(int argc, char * argv[])
 {
-    // Initializes the SDL.
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
-
-    // Creates a window.
-    SDL_Window* window = SDL_CreateWindow("Dynamic Fractal Canopy", 0, 0, INIT_WIDTH, INIT_HEIGHT,
-            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (window == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
-
-    // Creates a renderer.
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
-
-    // Dispatches the events.
-    event_loop(renderer);
-
-    // Destroys the objects.
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-
-    return EXIT_SUCCESS;
+    // Parses the options of the headless mode.
+    struct headless headless;
+    headless_parse(&headless, argc, argv, INIT_WIDTH, INIT_HEIGHT);
+
+    struct app app = { "Dynamic Fractal Canopy", INIT_WIDTH, INIT_HEIGHT, 0, draw, event, &MOUSE, sizeof(MOUSE) };
+    int status = app_run(&app, &headless);
+
+    segments_free(&SEGMENTS);
+    return status;
 }
@@ -1,133 +1,82 @@
-#include <err.h>
 #include <stdlib.h>
-#include <time.h>
-#include <SDL2/SDL.h>
+#include "app.h"
+#include "lsystem.h"
+#include "present.h"
+#include "curvecache.h"
 
-#define TOP_LEVEL 13
+#define TOP_LEVEL 20
 
-// Recursive function that draws the fractal canopy.
+// Level of the curve (number of folds).
+int LEVEL = 12;
+
+// Vertices of every level drawn so far at the current window size.
+struct curve_cache CACHE;
+
+// Generates the vertices of the dragon curve of a level.
 //
-// renderer: Renderer to draw on.
-// x: Abscissa of the starting point of the segments.
-// y: Ordinate of the starting point of the segments.
-// len: Length of the segments.
-// a: Angle use to rotate the segments.
-// level: Recursion level (0 = first iteration).
-void v(SDL_Renderer* renderer, int x, int y, int z, int t, int level)
+// level: Level of the curve.
+// w: Current width of the window.
+// h: Current height of the window.
+// out: Vertices of the curve (2^level + 1).
+void generate(int level, int w, int h, struct fpoint * out)
 {
-    // Trace
-    if (level == 0)
-        SDL_RenderDrawLine(renderer, x, y, z, t);
-    // Divide the current segment into 2 parts.
-    else
-    {
-        int m = (x+z)/2 + (t-y)/2;
-        int u = (y+t)/2 - (z-x)/2;
-        v(renderer, x, y, m, u, level-1);
-        v(renderer, z, t, m, u, level-1);
-    }
+    struct curve_writer writer = { out, 0 };
+    lsystem_generate(&DRAGON, w / 4, h/2, 3*w/4, h/2, level, curve_store, &writer);
 }
 
-// Initializes the renderer, draws the fractal canopy and updates the display.
+// Draws the dragon curve.
 //
 // renderer: Renderer to draw on.
+// surface: Unused (the dragon curve is drawn with the renderer).
 // w: Current width of the window.
 // h: Current height of the window.
-void draw(SDL_Renderer* renderer, int w, int h, int level)
+// state: Level of the curve (snapshot of LEVEL).
+void draw(SDL_Renderer* renderer, SDL_Surface * surface, int w, int h, const void * state)
 {
+    (void) surface;
 
     // If the width or the height is too small, we do not draw anything.
     if (w < 20 || h < 20)
         return;
 
-    // Clears the renderer (sets the background to black).
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+    // Takes the curve from the cache and draws it in a single call.
+    int level = *(const int *) state;
+    level = level > TOP_LEVEL ? TOP_LEVEL : level < 0 ? 0 : level;
+    draw_chunk(renderer, curve_cache_get(&CACHE, level, w, h), (1 << level) + 1);
+}
 
-    // Sets the color for drawing operations to white.
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+// The horizontal position of the mouse sets the level.
+int event(const SDL_Event * event, int w, int h, void * state)
+{
+    (void) h;
 
-    // Draws the fractal canopy. 
-    v(renderer, w / 4, h/2, 3*w/4, h/2, level > TOP_LEVEL ? TOP_LEVEL : level);
+    if (event->type != SDL_MOUSEMOTION)
+        return 0;
 
-    // Updates the display.
-    SDL_RenderPresent(renderer);
-}
+    // Nothing changes on screen while the level stays the same.
+    int * level = state;
+    double ratio = ((double) event->motion.x / (double) w) * (double) TOP_LEVEL;
+    if ((int) ratio == *level)
+        return 0;
 
-// Event loop that calls the relevant event handler.
-//
-// renderer: Renderer to draw on.
-void event_loop(SDL_Renderer* renderer, int level)
-{
-    // Width and height of the window.
-    int w = 500;
-    int h = 500;
-    double ratio;
-
-    // Draws the fractal canopy (first draw).
-    draw(renderer, w, h, level);
-
-    // Creates a variable to get the events.
-    SDL_Event event;
-
-    while (1)
-    {
-        // Waits for an event.
-        SDL_WaitEvent(&event);
-
-        switch (event.type)
-        {
-            // If the "quit" button is pushed, ends the event loop.
-            case SDL_QUIT:
-                return;
-
-            // If the window is resized, updates and redraws the diagonals.
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    w = event.window.data1;
-                    h = event.window.data2;
-                    draw(renderer, w, h, level);
-                }
-                break;
-            case SDL_MOUSEMOTION:
-                ratio = ((double) event.motion.x / (double) w) * (double) TOP_LEVEL;
-                draw(renderer, w, h, (int) ratio);
-                break;
-        }
-    }
+    *level = (int) ratio;
+    return 1;
 }
 
 int main(int argc, char * argv[])
 {
-    // Randomize
-    srand(time(NULL));
-
-    // Initializes the SDL.
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    // Parses the options of the headless mode.
+    struct headless headless;
+    argc = headless_parse(&headless, argc, argv, 500, 500);
 
-    // Creates a window.
-    SDL_Window* window = SDL_CreateWindow("Dynamic Dragon", 0, 0, 500, 500,
-            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (window == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
-
-    // Creates a renderer.
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
-
-    // Dispatches the events.
     if (argc == 2)
-        event_loop(renderer, atoi(argv[1]));
-    else
-        event_loop(renderer, 12);
+        LEVEL = atoi(argv[1]);
+
+    curve_cache_init(&CACHE, generate);
 
-    // Destroys the objects.
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    struct app app = { "Dynamic Dragon", 500, 500, 0, draw, event, &LEVEL, sizeof(LEVEL) };
+    int status = app_run(&app, &headless);
 
-    return EXIT_SUCCESS;
+    curve_cache_free(&CACHE);
+    return status;
 }
@@ -0,0 +1,351 @@
+#include <err.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "app.h"
+#include "framebuffer.h"
+#include "mailbox.h"
+#include "present.h"
+
+// Parameters of a frame, sent by the event loop to the render thread.
+struct snapshot
+{
+    int w;
+    int h;
+    // Copy of the state of the program (state_size bytes).
+    unsigned char state[];
+};
+
+// Render thread of the window: it draws the latest snapshot sent by the
+// event loop into a framebuffer, and sends the frame back, so the event
+// loop never waits for a frame to be computed.
+struct render
+{
+    const struct app * app;
+    pthread_t thread;
+    // Snapshots from the event loop, and frames (struct framebuffer) from
+    // the render thread.
+    struct mailbox snapshots;
+    struct mailbox frames;
+    struct snapshot * buffers[3];
+    struct framebuffer framebuffers[3];
+    // Wakes the render thread up when a snapshot is sent or when it must
+    // stop.
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int stopping;
+    // Type of the event pushed when a frame is sent.
+    Uint32 frame_event;
+    // Start of the frame being drawn and duration of a refresh of the
+    // display (in performance counter ticks), and whether the frame has
+    // been cancelled.
+    Uint64 start;
+    Uint64 refresh;
+    int cancelled;
+    // Size of the frame being drawn.
+    int w;
+    int h;
+};
+
+// Render thread of the window (its app is NULL in headless mode).
+static struct render RENDER;
+
+int app_cancelled(void)
+{
+    struct render * render = &RENDER;
+    if (render->app == NULL)
+        return 0;
+
+    if (__atomic_load_n(&render->cancelled, __ATOMIC_RELAXED)
+            || __atomic_load_n(&render->stopping, __ATOMIC_RELAXED))
+        return 1;
+
+    // A frame shorter than a refresh is shown anyway before the next one.
+    Uint64 start = __atomic_load_n(&render->start, __ATOMIC_RELAXED);
+    if (!mailbox_pending(&render->snapshots)
+            || SDL_GetPerformanceCounter() - start < render->refresh)
+        return 0;
+
+    __atomic_store_n(&render->cancelled, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+// Sends the frame of the render thread to the event loop.
+static void render_publish(struct render * render)
+{
+    mailbox_publish(&render->frames);
+
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = render->frame_event;
+    SDL_PushEvent(&event);
+}
+
+SDL_Surface * app_preview(SDL_Surface * surface)
+{
+    // Only the final frame is written in headless mode, and a cancelled
+    // frame is not shown at all.
+    struct render * render = &RENDER;
+    if (render->app == NULL || app_cancelled())
+        return surface;
+
+    render_publish(render);
+    return framebuffer_get(mailbox_back(&render->frames), render->w, render->h);
+}
+
+// Draws a frame into a surface, with a software renderer on it (in renderer
+// mode, it is cleared in black and draws in white).
+//
+// app: Program.
+// surface: Surface of the frame.
+// w: Width of the frame.
+// h: Height of the frame.
+// state: State of the program.
+static void draw_frame(const struct app * app, SDL_Surface * surface, int w, int h, const void * state)
+{
+    SDL_Renderer * renderer = SDL_CreateSoftwareRenderer(surface);
+    if (renderer == NULL)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    if (!app->surface)
+    {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    }
+    app->draw(renderer, surface, w, h, state);
+
+    SDL_DestroyRenderer(renderer);
+}
+
+// Main function of the render thread: draws the snapshots until it stops.
+static void * render_main(void * data)
+{
+    struct render * render = data;
+
+    while (1)
+    {
+        // Sleeps until a snapshot is sent.
+        pthread_mutex_lock(&render->lock);
+        while (!render->stopping && !mailbox_pending(&render->snapshots))
+            pthread_cond_wait(&render->wake, &render->lock);
+        int stopping = render->stopping;
+        pthread_mutex_unlock(&render->lock);
+        if (stopping)
+            return NULL;
+
+        const struct snapshot * snapshot = mailbox_take(&render->snapshots);
+        __atomic_store_n(&render->cancelled, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&render->start, SDL_GetPerformanceCounter(), __ATOMIC_RELAXED);
+
+        render->w = snapshot->w;
+        render->h = snapshot->h;
+
+        struct framebuffer * framebuffer = mailbox_back(&render->frames);
+        SDL_Surface * surface = framebuffer_get(framebuffer, snapshot->w, snapshot->h);
+        draw_frame(render->app, surface, snapshot->w, snapshot->h, snapshot->state);
+
+        // A cancelled frame is dropped, the next snapshot is drawn at once.
+        if (__atomic_load_n(&render->cancelled, __ATOMIC_RELAXED))
+            continue;
+
+        render_publish(render);
+    }
+}
+
+// Starts the render thread of a window.
+//
+// render: Render thread.
+// app: Program.
+// renderer: Renderer of the window.
+static void render_start(struct render * render, const struct app * app, SDL_Renderer * renderer)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        render->buffers[i] = malloc(sizeof(struct snapshot) + app->state_size);
+        if (!render->buffers[i])
+            errx(EXIT_FAILURE, "Unable to allocate the snapshots");
+        framebuffer_init(&render->framebuffers[i]);
+    }
+    mailbox_init(&render->snapshots, render->buffers[0], render->buffers[1], render->buffers[2]);
+    mailbox_init(&render->frames, &render->framebuffers[0], &render->framebuffers[1],
+            &render->framebuffers[2]);
+
+    // Paces the cancellations on the refresh rate of the display.
+    SDL_DisplayMode mode;
+    int display = SDL_GetWindowDisplayIndex(SDL_RenderGetWindow(renderer));
+    int rate = display >= 0 && SDL_GetCurrentDisplayMode(display, &mode) == 0
+        && mode.refresh_rate > 0 ? mode.refresh_rate : 60;
+    render->refresh = SDL_GetPerformanceFrequency() / rate;
+
+    render->frame_event = SDL_RegisterEvents(1);
+    if (render->frame_event == (Uint32) -1)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    pthread_mutex_init(&render->lock, NULL);
+    pthread_cond_init(&render->wake, NULL);
+    render->stopping = 0;
+    render->cancelled = 0;
+    render->app = app;
+    if (pthread_create(&render->thread, NULL, render_main, render))
+        errx(EXIT_FAILURE, "Unable to start the render thread");
+}
+
+// Sends the current state of the program to the render thread.
+//
+// render: Render thread.
+// w: Current width of the window.
+// h: Current height of the window.
+static void render_send(struct render * render, int w, int h)
+{
+    struct snapshot * snapshot = mailbox_back(&render->snapshots);
+    snapshot->w = w;
+    snapshot->h = h;
+    if (render->app->state_size)
+        memcpy(snapshot->state, render->app->state, render->app->state_size);
+    mailbox_publish(&render->snapshots);
+
+    pthread_mutex_lock(&render->lock);
+    pthread_cond_signal(&render->wake);
+    pthread_mutex_unlock(&render->lock);
+}
+
+// Stops the render thread (cancelling its frame) and frees its buffers.
+static void render_stop(struct render * render)
+{
+    pthread_mutex_lock(&render->lock);
+    __atomic_store_n(&render->stopping, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&render->wake);
+    pthread_mutex_unlock(&render->lock);
+    pthread_join(render->thread, NULL);
+
+    for (int i = 0; i < 3; i++)
+    {
+        framebuffer_free(&render->framebuffers[i]);
+        free(render->buffers[i]);
+    }
+    pthread_cond_destroy(&render->wake);
+    pthread_mutex_destroy(&render->lock);
+    render->app = NULL;
+}
+
+// Renders a single frame offscreen, without initializing video.
+static int headless_run(const struct app * app, const struct headless * headless)
+{
+    SDL_Surface * surface = headless_surface(headless);
+    draw_frame(app, surface, headless->w, headless->h, app->state);
+    headless_write(headless, surface);
+
+    SDL_FreeSurface(surface);
+    return EXIT_SUCCESS;
+}
+
+// Event loop that calls the relevant event handler, while the frames are
+// drawn by the render thread.
+static void event_loop(const struct app * app, SDL_Renderer * renderer)
+{
+    // Width and height of the window.
+    int w = app->w;
+    int h = app->h;
+
+    // Creates the presentation layer of the window and starts the render
+    // thread.
+    struct presenter presenter;
+    present_init(&presenter, renderer);
+    render_start(&RENDER, app, renderer);
+
+    // Creates a variable to get the events.
+    SDL_Event event;
+
+    // Whether the state changed since the last snapshot (first draw).
+    int dirty = 1;
+
+    while (1)
+    {
+        // Sends the latest state to the render thread.
+        if (dirty)
+            render_send(&RENDER, w, h);
+        dirty = 0;
+
+        // Waits for an event, then drains the queue: the handlers only
+        // update the state of the program, which is sent once for the
+        // whole burst of events.
+        struct framebuffer * frame = NULL;
+        SDL_WaitEvent(&event);
+        do
+        {
+            // A frame is ready (only the latest one is shown).
+            if (event.type == RENDER.frame_event)
+            {
+                struct framebuffer * ready = mailbox_take(&RENDER.frames);
+                if (ready)
+                    frame = ready;
+                continue;
+            }
+
+            switch (event.type)
+            {
+                // If the "quit" button is pushed, ends the event loop.
+                case SDL_QUIT:
+                    render_stop(&RENDER);
+                    present_quit(&presenter);
+                    return;
+
+                // If the window is resized, the fractal is redrawn at its
+                // new size.
+                case SDL_WINDOWEVENT:
+                    if (event.window.event == SDL_WINDOWEVENT_RESIZED)
+                    {
+                        w = event.window.data1;
+                        h = event.window.data2;
+                        dirty = 1;
+                    }
+                    break;
+
+                default:
+                    if (app->event && app->event(&event, w, h, app->state))
+                        dirty = 1;
+                    break;
+            }
+        }
+        while (SDL_PollEvent(&event));
+
+        // Uploads the frame into the window texture and displays it (waits
+        // for the vertical sync).
+        if (frame)
+            present_surface(&presenter, frame->surface, frame->w, frame->h);
+    }
+}
+
+int app_run(const struct app * app, const struct headless * headless)
+{
+    if (headless->enabled)
+        return headless_run(app, headless);
+
+    // Initializes the SDL.
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    // Creates a window.
+    SDL_Window* window = SDL_CreateWindow(app->title, 0, 0, app->w, app->h,
+            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+    if (window == NULL)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    // Creates a renderer, synchronized with the display: a frame is presented
+    // at most once per refresh.
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1,
+            SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (renderer == NULL)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    // Dispatches the events.
+    event_loop(app, renderer);
+
+    // Destroys the objects.
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#ifndef APP_H
+#define APP_H
+
+#include <SDL2/SDL.h>
+#include "headless.h"
+
+// Window, event loop and headless mode shared by every program: a program
+// only describes how to draw a frame and how to react to its own events.
+// The frames are drawn by a render thread, from snapshots of the state of
+// the program taken by the event loop, so the window stays responsive
+// while a frame is computed.
+struct app
+{
+    // Title and initial size of the window.
+    const char * title;
+    int w;
+    int h;
+    // Whether the frames are written into the surface rather than drawn
+    // with the (software) renderer of the surface.
+    int surface;
+    // Draws a w x h frame of a snapshot of the state (render thread). In
+    // renderer mode, the renderer is cleared in black and its color set to
+    // white beforehand; in surface mode, the frame is written into the
+    // surface (which is at least w x h).
+    void (*draw)(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h, const void * state);
+    // Handles an event other than quitting or resizing the window (can be
+    // NULL), by updating the state (event loop). Returns whether the frame
+    // must be drawn again: a snapshot is taken once the queue is empty.
+    int (*event)(const SDL_Event * event, int w, int h, void * state);
+    // State of the program (state_size bytes, can be NULL): only the events
+    // change it, and the render thread only reads snapshots of it.
+    void * state;
+    size_t state_size;
+};
+
+// Whether the frame being drawn is obsolete: once it has been drawing for a
+// refresh of the display, a newer snapshot cancels it. It is then dropped,
+// and the render thread draws the snapshot.
+// The long draws check it (from any thread) to return early.
+int app_cancelled(void);
+
+// Shows the frame drawn so far into the surface (a preview of the final
+// frame, from draw() in surface mode), and returns the surface to go on drawing into: the
+// frame is sent to the window, so the surface changes (its pixels are then
+// undefined) unless in headless mode or if the frame is cancelled.
+SDL_Surface * app_preview(SDL_Surface * surface);
+
+// Renders a single frame into the output file in headless mode, otherwise
+// opens the window and dispatches its events until it is closed.
+// Returns the exit status of the program.
+int app_run(const struct app * app, const struct headless * headless);
+
+#endif
@@ -0,0 +1,68 @@
+#include <err.h>
+#include <stdlib.h>
+#include "curvecache.h"
+
+void curve_cache_init(struct curve_cache * cache, curve_func generate)
+{
+    cache->generate = generate;
+    cache->w = 0;
+    cache->h = 0;
+    for (int i = 0; i < CURVE_CACHE_LEVELS; i++)
+        cache->levels[i] = NULL;
+}
+
+void curve_cache_free(struct curve_cache * cache)
+{
+    for (int i = 0; i < CURVE_CACHE_LEVELS; i++)
+    {
+        free(cache->levels[i]);
+        cache->levels[i] = NULL;
+    }
+}
+
+const struct fpoint * curve_cache_get(struct curve_cache * cache, int level, int w, int h)
+{
+    // Every vertex moves when the window is resized.
+    if (cache->w != w || cache->h != h)
+    {
+        curve_cache_free(cache);
+        cache->w = w;
+        cache->h = h;
+    }
+
+    if (cache->levels[level])
+        return cache->levels[level];
+
+    size_t count = ((size_t) 1 << level) + 1;
+    struct fpoint * points = malloc(count * sizeof(struct fpoint));
+    if (!points)
+        errx(EXIT_FAILURE, "Unable to allocate the vertices of level %d", level);
+
+    // Decimates the closest finer level, if any.
+    int finer = level + 1;
+    while (finer < CURVE_CACHE_LEVELS && !cache->levels[finer])
+        finer++;
+
+    if (finer < CURVE_CACHE_LEVELS)
+    {
+        const struct fpoint * src = cache->levels[finer];
+        size_t stride = (size_t) 1 << (finer - level);
+        for (size_t i = 0; i < count; i++)
+            points[i] = src[i * stride];
+    }
+    else
+        cache->generate(level, w, h, points);
+
+    cache->levels[level] = points;
+    return points;
+}
+
+void curve_store(void * data, const struct fpoint * points, int count)
+{
+    struct curve_writer * writer = data;
+
+    // The first vertex of a chunk is the last one of the previous chunk.
+    int first = writer->len > 0 ? 1 : 0;
+    for (int i = first; i < count; i++)
+        writer->out[writer->len++] = points[i];
+}
@@ -0,0 +1,43 @@
+#ifndef CURVECACHE_H
+#define CURVECACHE_H
+
+#include <stddef.h>
+#include "lsystem.h"
+
+// Number of levels a cache can hold (0 to CURVE_CACHE_LEVELS - 1).
+#define CURVE_CACHE_LEVELS 25
+
+// Generates the 2^level + 1 vertices of a curve drawn in a w x h window.
+typedef void (*curve_func)(int level, int w, int h, struct fpoint * out);
+
+// Vertices of a curve for every level already computed, for one window
+// size. The vertices of a level are the even vertices of the next level,
+// so a level is taken from a finer one when there is one.
+struct curve_cache
+{
+    curve_func generate;
+    int w;
+    int h;
+    struct fpoint * levels[CURVE_CACHE_LEVELS];
+};
+
+// Initializes an empty cache.
+void curve_cache_init(struct curve_cache * cache, curve_func generate);
+// Frees the vertices of a cache.
+void curve_cache_free(struct curve_cache * cache);
+// Vertices (2^level + 1 of them) of a level for a w x h window, computed or
+// derived only if they are not cached yet.
+const struct fpoint * curve_cache_get(struct curve_cache * cache, int level, int w, int h);
+
+// Destination of curve_store(): the vertices are written from out[len].
+struct curve_writer
+{
+    struct fpoint * out;
+    size_t len;
+};
+
+// Sink of lsystem_generate() storing the vertices into an array (data is a
+// struct curve_writer, whose len starts at 0).
+void curve_store(void * data, const struct fpoint * points, int count);
+
+#endif
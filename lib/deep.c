@@ -0,0 +1,269 @@
+// Deep zoom engine: perturbation theory with series approximation.
+//
+// A pixel c = C + dc is iterated as z = Z + d, where Z is the reference
+// orbit of the center C and d follows d' = 2 * Z * d + d^2 + dc, which only
+// needs double precision whatever the zoom. When |Z + d| < |d| the offset
+// has lost its precision (a glitch): the pixel is rebased on the start of
+// the reference orbit (d = Z + d, Z = 0).
+//
+// Like kernel.c, this file must be built with -ffp-contract=off (the
+// double-double arithmetic relies on exactly rounded products).
+
+#include <err.h>
+#include <stdlib.h>
+#include "deep.h"
+
+// Relative error above which the series approximation is no longer used.
+#define SERIES_TOLERANCE 1e-11
+
+// Exact sum: s + e = a + b.
+static struct dd two_sum(double a, double b)
+{
+    double s = a + b;
+    double bb = s - a;
+    double e = (a - (s - bb)) + (b - bb);
+    struct dd r = { s, e };
+    return r;
+}
+
+// Exact sum, provided that |a| >= |b|.
+static struct dd quick_two_sum(double a, double b)
+{
+    double s = a + b;
+    double e = b - (s - a);
+    struct dd r = { s, e };
+    return r;
+}
+
+// Dekker split of a double into two halves of 26 bits.
+static void split(double a, double * hi, double * lo)
+{
+    double t = 134217729.0 * a;
+    *hi = t - (t - a);
+    *lo = a - *hi;
+}
+
+// Exact product: p + e = a * b.
+static struct dd two_prod(double a, double b)
+{
+    double ah, al, bh, bl;
+    double p = a * b;
+    split(a, &ah, &al);
+    split(b, &bh, &bl);
+    double e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+    struct dd r = { p, e };
+    return r;
+}
+
+struct dd dd_from(double a)
+{
+    struct dd r = { a, 0 };
+    return r;
+}
+
+struct dd dd_add(struct dd a, struct dd b)
+{
+    struct dd s = two_sum(a.hi, b.hi);
+    s.lo += a.lo + b.lo;
+    return quick_two_sum(s.hi, s.lo);
+}
+
+struct dd dd_neg(struct dd a)
+{
+    struct dd r = { -a.hi, -a.lo };
+    return r;
+}
+
+struct dd dd_add_d(struct dd a, double b)
+{
+    struct dd s = two_sum(a.hi, b);
+    s.lo += a.lo;
+    return quick_two_sum(s.hi, s.lo);
+}
+
+struct dd dd_mul(struct dd a, struct dd b)
+{
+    struct dd p = two_prod(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return quick_two_sum(p.hi, p.lo);
+}
+
+// Multiplication of complex numbers given as (re, im) pairs.
+static void cmul(const double * a, const double * b, double * r)
+{
+    double re = a[0] * b[0] - a[1] * b[1];
+    double im = a[0] * b[1] + a[1] * b[0];
+    r[0] = re;
+    r[1] = im;
+}
+
+// Value of the series approximation for the offset dc.
+static void series(const double * a, const double * b, const double * c, const double * dc,
+        double * r)
+{
+    double dc2[2], dc3[2], t[2];
+
+    cmul(dc, dc, dc2);
+    cmul(dc2, dc, dc3);
+
+    cmul(a, dc, r);
+    cmul(b, dc2, t);
+    r[0] += t[0];
+    r[1] += t[1];
+    cmul(c, dc3, t);
+    r[0] += t[0];
+    r[1] += t[1];
+}
+
+void reference_compute(struct reference * ref, struct dd cx, struct dd cy, int iter,
+        double rx, double ry)
+{
+    ref->zx = realloc(ref->zx, (iter + 1) * sizeof(double));
+    ref->zy = realloc(ref->zy, (iter + 1) * sizeof(double));
+    if (!ref->zx || !ref->zy)
+        errx(EXIT_FAILURE, "Unable to allocate the reference orbit");
+
+    // Orbit of the center, in double-double.
+    struct dd x = dd_from(0), y = dd_from(0);
+    int n = 0;
+    ref->zx[0] = 0;
+    ref->zy[0] = 0;
+    while (n < iter && x.hi * x.hi + y.hi * y.hi <= 4)
+    {
+        struct dd xx = dd_mul(x, x);
+        struct dd yy = dd_mul(y, y);
+        struct dd xy = dd_mul(x, y);
+        x = dd_add(dd_add(xx, dd_neg(yy)), cx);
+        y = dd_add(dd_add(xy, xy), cy);
+        n++;
+        ref->zx[n] = x.hi;
+        ref->zy[n] = y.hi;
+    }
+    ref->len = n;
+
+    // Series approximation: d_n = a_n * dc + b_n * dc^2 + c_n * dc^3, with
+    // a' = 2Za + 1, b' = 2Zb + a^2, c' = 2Zc + 2ab. It is advanced as long
+    // as it matches the exact offsets of the corners of the view.
+    const double probes[4][2] = { { -rx, -ry }, { rx, -ry }, { -rx, ry }, { rx, ry } };
+    double d[4][2] = { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } };
+    double a[2] = { 0, 0 }, b[2] = { 0, 0 }, c[2] = { 0, 0 };
+
+    ref->skip = 0;
+    for (int m = 0; m < ref->len; m++)
+    {
+        double z[2] = { 2 * ref->zx[m], 2 * ref->zy[m] };
+        double na[2], nb[2], nc[2], t[2];
+        int valid = 1;
+
+        cmul(z, a, na);
+        na[0] += 1;
+        cmul(z, b, nb);
+        cmul(a, a, t);
+        nb[0] += t[0];
+        nb[1] += t[1];
+        cmul(z, c, nc);
+        cmul(a, b, t);
+        nc[0] += 2 * t[0];
+        nc[1] += 2 * t[1];
+
+        for (int p = 0; p < 4 && valid; p++)
+        {
+            double nd[2], approx[2];
+            cmul(z, d[p], nd);
+            cmul(d[p], d[p], t);
+            nd[0] += t[0] + probes[p][0];
+            nd[1] += t[1] + probes[p][1];
+
+            // Stops before a corner escapes or glitches.
+            double zr = ref->zx[m + 1] + nd[0];
+            double zi = ref->zy[m + 1] + nd[1];
+            double r2 = zr * zr + zi * zi;
+            double d2 = nd[0] * nd[0] + nd[1] * nd[1];
+            if (r2 > 4 || r2 < d2)
+                valid = 0;
+
+            series(na, nb, nc, probes[p], approx);
+            double ex = approx[0] - nd[0];
+            double ey = approx[1] - nd[1];
+            if (ex * ex + ey * ey > SERIES_TOLERANCE * SERIES_TOLERANCE * d2)
+                valid = 0;
+
+            d[p][0] = nd[0];
+            d[p][1] = nd[1];
+        }
+
+        if (!valid)
+            break;
+
+        a[0] = na[0];
+        a[1] = na[1];
+        b[0] = nb[0];
+        b[1] = nb[1];
+        c[0] = nc[0];
+        c[1] = nc[1];
+        ref->skip = m + 1;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        ref->a[i] = a[i];
+        ref->b[i] = b[i];
+        ref->c[i] = c[i];
+    }
+}
+
+void reference_free(struct reference * ref)
+{
+    free(ref->zx);
+    free(ref->zy);
+    ref->zx = NULL;
+    ref->zy = NULL;
+}
+
+int deep_point(const struct reference * ref, double dcx, double dcy, int iter,
+        double * ex, double * ey)
+{
+    const double * zx = ref->zx;
+    const double * zy = ref->zy;
+    double dc[2] = { dcx, dcy };
+    double d[2] = { 0, 0 };
+    int n = 0;
+    int m = 0;
+
+    // Starts after the iterations covered by the series approximation.
+    if (ref->skip > 0 && ref->skip < iter)
+    {
+        series(ref->a, ref->b, ref->c, dc, d);
+        n = m = ref->skip;
+    }
+
+    double dx = d[0], dy = d[1];
+    double x = 0, y = 0;
+    while (n < iter)
+    {
+        x = zx[m] + dx;
+        y = zy[m] + dy;
+        double r2 = x * x + y * y;
+        if (r2 > 4)
+            break;
+
+        // Glitch (or end of the reference orbit): rebases on Z = 0.
+        if (r2 < dx * dx + dy * dy || m == ref->len)
+        {
+            dx = x;
+            dy = y;
+            m = 0;
+        }
+
+        double ndx = 2 * (zx[m] * dx - zy[m] * dy) + (dx * dx - dy * dy) + dcx;
+        double ndy = 2 * (zx[m] * dy + zy[m] * dx) + 2 * dx * dy + dcy;
+        dx = ndx;
+        dy = ndy;
+        m++;
+        n++;
+    }
+
+    *ex = x;
+    *ey = y;
+    return n;
+}
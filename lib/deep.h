@@ -0,0 +1,49 @@
+#ifndef DEEP_H
+#define DEEP_H
+
+// Double-double number: hi + lo with |lo| <= ulp(hi) / 2, which gives about
+// 106 bits of mantissa (enough for zooms down to 1e-28).
+struct dd
+{
+    double hi;
+    double lo;
+};
+
+struct dd dd_from(double a);
+struct dd dd_neg(struct dd a);
+struct dd dd_add(struct dd a, struct dd b);
+struct dd dd_add_d(struct dd a, double b);
+struct dd dd_mul(struct dd a, struct dd b);
+
+// Reference orbit of the deep zoom engine: the orbit of the center of the
+// view is computed once in double-double, and every pixel is iterated as a
+// double precision offset (perturbation) from it.
+struct reference
+{
+    // Orbit of the center, rounded to double (len + 1 points).
+    double * zx;
+    double * zy;
+    // Index of the last point: the center escaped there, or len = iter.
+    int len;
+    // Number of iterations skipped by the series approximation.
+    int skip;
+    // Coefficients of the series approximation at skip:
+    // offset = a * dc + b * dc^2 + c * dc^3 (complex numbers).
+    double a[2];
+    double b[2];
+    double c[2];
+};
+
+// Computes the reference orbit of the center (cx, cy) up to iter iterations,
+// and the series approximation, validated on the corners of the view
+// (offsets up to rx and ry from the center).
+void reference_compute(struct reference * ref, struct dd cx, struct dd cy, int iter,
+        double rx, double ry);
+// Frees the orbit of a reference.
+void reference_free(struct reference * ref);
+// Iteration count of the point at the offset (dcx, dcy) from the center.
+// The last point of its orbit tested for escape is stored in (ex, ey).
+int deep_point(const struct reference * ref, double dcx, double dcy, int iter,
+        double * ex, double * ey);
+
+#endif
@@ -0,0 +1,248 @@
+// The kernels of the formulas are written once, with the vector extensions
+// of GCC, in resume(): it is always inlined into a function per formula
+// and per instruction set, where the formula is a constant, so the switch
+// of step() is resolved at compile time and every formula gets its own
+// loop. The vectors of LANES doubles are single AVX2 registers in the AVX2
+// variants, and pairs of SSE2 registers otherwise.
+
+#include <math.h>
+#include "escape.h"
+#include "kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ESCAPE_X86
+#endif
+
+// Number of orbits iterated together.
+#define LANES 4
+// Number of iterations before the first move of the periodicity checkpoint
+// (see kernel.c).
+#define PERIOD 8
+// Iterations past the escape of the normalized iteration counts.
+#define SMOOTH_EXTRA 4
+
+typedef double vdouble __attribute__((vector_size(LANES * sizeof(double))));
+typedef long long vmask __attribute__((vector_size(LANES * sizeof(double))));
+
+static escape_func kernels[FORMULAS];
+
+static const char * names[FORMULAS] =
+{
+    "mandelbrot", "julia", "multibrot3", "multibrot4", "burning-ship", "tricorn"
+};
+
+// Lanes of a where mask is set, and of b elsewhere (the vectors are only
+// passed to the macros and the inline functions by address, as they do
+// not fit the registers of the calling convention without AVX).
+#define BLEND(mask, a, b) ((vdouble) (((vmask) (a) & (mask)) | ((vmask) (b) & ~(mask))))
+// Whether any lane of a mask is set.
+#define ANY(mask) (((mask)[0] | (mask)[1] | (mask)[2] | (mask)[3]) != 0)
+
+// One iteration of a formula, z = x + i * y.
+static inline __attribute__((always_inline)) void step(enum formula formula,
+        vdouble * x, vdouble * y, const vdouble * c_x, const vdouble * c_y)
+{
+    vdouble a = *x;
+    vdouble b = *y;
+    vdouble cx = *c_x;
+    vdouble cy = *c_y;
+    const vmask magnitude = { ~(1ULL << 63), ~(1ULL << 63), ~(1ULL << 63), ~(1ULL << 63) };
+
+    switch (formula)
+    {
+        case MULTIBROT3:
+        {
+            vdouble aa = a * a;
+            vdouble bb = b * b;
+            *x = a * (aa - 3 * bb) + cx;
+            *y = b * (3 * aa - bb) + cy;
+            break;
+        }
+        case MULTIBROT4:
+        {
+            vdouble re = a * a - b * b;
+            vdouble im = 2 * a * b;
+            *x = re * re - im * im + cx;
+            *y = 2 * re * im + cy;
+            break;
+        }
+        case BURNING_SHIP:
+            a = (vdouble) ((vmask) a & magnitude);
+            b = (vdouble) ((vmask) b & magnitude);
+            *x = a * a - b * b + cx;
+            *y = 2 * a * b + cy;
+            break;
+        case TRICORN:
+            *x = a * a - b * b + cx;
+            *y = -2 * a * b + cy;
+            break;
+        default:
+            *x = a * a - b * b + cx;
+            *y = 2 * a * b + cy;
+            break;
+    }
+}
+
+// Resumable kernel of a formula (see escape_func), LANES orbits at a time.
+static inline __attribute__((always_inline)) long resume(enum formula formula,
+        const struct escape * escape, const double * cx, const double * cy,
+        double * zx, double * zy, int * n, int count, int iter)
+{
+    const vdouble limit = { iter, iter, iter, iter };
+    vdouble saved = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < count; i += LANES)
+    {
+        // The lanes past count have already reached iter.
+        int len = count - i < LANES ? count - i : LANES;
+        vdouble x0 = { 0 }, y0 = { 0 }, x = { 0 }, y = { 0 }, m = limit;
+        for (int l = 0; l < len; l++)
+        {
+            x0[l] = cx[i + l];
+            y0[l] = cy[i + l];
+            x[l] = zx[i + l];
+            y[l] = zy[i + l];
+            m[l] = n[i + l];
+        }
+
+        // The orbits of the Julia set start at their point.
+        if (formula == JULIA)
+        {
+            vmask start = m == 0;
+            x = BLEND(start, x0, x);
+            y = BLEND(start, y0, y);
+            x0 = (vdouble) { escape->kx, escape->kx, escape->kx, escape->kx };
+            y0 = (vdouble) { escape->ky, escape->ky, escape->ky, escape->ky };
+        }
+
+        vdouble hx = x, hy = y;
+        vmask active = { -1, -1, -1, -1 };
+        int since = 0, period = PERIOD;
+        while (1)
+        {
+            active &= (x * x + y * y <= 4) & (m < limit);
+            if (!ANY(active))
+                break;
+            m += (vdouble) ((vmask) (vdouble) { 1, 1, 1, 1 } & active);
+
+            vdouble nx = x, ny = y;
+            step(formula, &nx, &ny, &x0, &y0);
+            x = BLEND(active, nx, x);
+            y = BLEND(active, ny, y);
+
+            // A periodic orbit never escapes.
+            vmask cycle = active & (x == hx) & (y == hy);
+            if (ANY(cycle))
+            {
+                saved += BLEND(cycle, limit - m, (vdouble) { 0 });
+                m = BLEND(cycle, limit, m);
+            }
+            if (++since == period)
+            {
+                hx = x;
+                hy = y;
+                since = 0;
+                period *= 2;
+            }
+        }
+
+        for (int l = 0; l < len; l++)
+        {
+            zx[i + l] = x[l];
+            zy[i + l] = y[l];
+            n[i + l] = (int) m[l];
+        }
+    }
+
+    return (long) (saved[0] + saved[1] + saved[2] + saved[3]);
+}
+
+// The Mandelbrot set uses the kernel of kernel.h.
+static long mandelbrot(const struct escape * escape, const double * cx, const double * cy,
+        double * zx, double * zy, int * n, int count, int iter)
+{
+    (void) escape;
+    return mandelbrot_resume(cx, cy, zx, zy, n, count, iter);
+}
+
+// Kernel of a formula for an instruction set.
+#define KERNEL(name, formula, suffix, attributes) \
+    attributes static long name##_##suffix(const struct escape * escape, \
+            const double * cx, const double * cy, double * zx, double * zy, \
+            int * n, int count, int iter) \
+    { \
+        return resume(formula, escape, cx, cy, zx, zy, n, count, iter); \
+    }
+
+// Kernels of every formula for an instruction set.
+#define KERNELS(suffix, attributes) \
+    KERNEL(julia, JULIA, suffix, attributes) \
+    KERNEL(multibrot3, MULTIBROT3, suffix, attributes) \
+    KERNEL(multibrot4, MULTIBROT4, suffix, attributes) \
+    KERNEL(burning_ship, BURNING_SHIP, suffix, attributes) \
+    KERNEL(tricorn, TRICORN, suffix, attributes)
+
+KERNELS(generic, )
+#ifdef ESCAPE_X86
+KERNELS(avx2, __attribute__((target("avx2"))))
+#endif
+
+void escape_init(void)
+{
+    kernels[MANDELBROT] = mandelbrot;
+    kernels[JULIA] = julia_generic;
+    kernels[MULTIBROT3] = multibrot3_generic;
+    kernels[MULTIBROT4] = multibrot4_generic;
+    kernels[BURNING_SHIP] = burning_ship_generic;
+    kernels[TRICORN] = tricorn_generic;
+
+#ifdef ESCAPE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kernels[JULIA] = julia_avx2;
+        kernels[MULTIBROT3] = multibrot3_avx2;
+        kernels[MULTIBROT4] = multibrot4_avx2;
+        kernels[BURNING_SHIP] = burning_ship_avx2;
+        kernels[TRICORN] = tricorn_avx2;
+    }
+#endif
+}
+
+escape_func escape_kernel(enum formula formula)
+{
+    return kernels[formula];
+}
+
+const char * escape_name(enum formula formula)
+{
+    return names[formula];
+}
+
+float escape_smooth_count(const struct escape * escape, double cx, double cy, int n,
+        double zx, double zy)
+{
+    if (escape->formula == MANDELBROT)
+        return mandelbrot_smooth_count(cx, cy, n, zx, zy);
+    if (zx*zx + zy*zy <= 4)
+        return (float) n;
+
+    if (escape->formula == JULIA)
+    {
+        cx = escape->kx;
+        cy = escape->ky;
+    }
+
+    // The orbit is continued in the first lane.
+    vdouble x = { zx }, y = { zy };
+    vdouble x0 = { cx }, y0 = { cy };
+    for (int i = 0; i < SMOOTH_EXTRA; i++)
+        step(escape->formula, &x, &y, &x0, &y0);
+
+    // log_d(log2(|z|)) grows by about 1 per iteration of a formula of
+    // degree d.
+    int degree = escape->formula == MULTIBROT3 ? 3 : escape->formula == MULTIBROT4 ? 4 : 2;
+    double count = n + 1 - log(0.5 * log2(x[0] * x[0] + y[0] * y[0])) / log(degree)
+        + SMOOTH_EXTRA;
+    return count > 0 ? (float) count : 0;
+}
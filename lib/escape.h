@@ -0,0 +1,47 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+// Escape-time formulas: the orbit z -> f(z) + c starts at z = 0, c being
+// the point, except for the Julia set, where it starts at the point and c
+// is a constant. A point is outside when its orbit leaves the disk of
+// radius 2.
+enum formula
+{
+    MANDELBROT,     // z^2 + c
+    JULIA,          // z^2 + k, from z = c
+    MULTIBROT3,     // z^3 + c
+    MULTIBROT4,     // z^4 + c
+    BURNING_SHIP,   // (|x| + i * |y|)^2 + c
+    TRICORN,        // conj(z)^2 + c
+    FORMULAS
+};
+
+// Formula of a frame, with the constant k = kx + i * ky of the Julia set.
+struct escape
+{
+    enum formula formula;
+    double kx;
+    double ky;
+};
+
+// Resumable kernel of a formula: the same contract as mandelbrot_resume()
+// (see kernel.h), with c = cx[i] + i * cy[i]. Every formula has its own
+// specialized loop (the formula is a constant of it, not a test per
+// iteration); the Mandelbrot set uses mandelbrot_resume(), the only one with
+// the interior checks of the cardioid and of the bulb. The orbits of every
+// formula are checked for periodicity.
+typedef long (*escape_func)(const struct escape * escape, const double * cx, const double * cy,
+        double * zx, double * zy, int * n, int count, int iter);
+
+// Selects the kernels of the formulas for the CPU (called by kernel_init()).
+void escape_init(void);
+// Resumable kernel of a formula.
+escape_func escape_kernel(enum formula formula);
+// Name of a formula.
+const char * escape_name(enum formula formula);
+// Normalized iteration count of an orbit of a formula (see
+// mandelbrot_smooth_count()).
+float escape_smooth_count(const struct escape * escape, double cx, double cy, int n,
+        double zx, double zy);
+
+#endif
@@ -0,0 +1,143 @@
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "export.h"
+
+// Path of a file next to the output.
+static char * sibling(const char * out, const char * suffix)
+{
+    char * path = malloc(strlen(out) + strlen(suffix) + 1);
+    if (!path)
+        errx(EXIT_FAILURE, "Unable to allocate the paths of the export");
+
+    strcpy(path, out);
+    strcat(path, suffix);
+    return path;
+}
+
+// Reads the checkpoint of a previous export of the same image: the row it
+// reached, the size of the partial file and the checksum of its pixels.
+// Returns whether there is one.
+static int load(const struct export * export, int * row, long * offset, unsigned * adler)
+{
+    FILE * file = fopen(export->checkpoint, "r");
+    if (!file)
+        return 0;
+
+    int w, h;
+    char key[1024];
+    int valid = fscanf(file, "%d %d %d %ld %u ", &w, &h, row, offset, adler) == 5
+        && fgets(key, sizeof(key), file) != NULL;
+    fclose(file);
+
+    key[strcspn(key, "\n")] = '\0';
+    return valid && w == export->w && h == export->h && strcmp(key, export->key) == 0
+        && *row > 0 && *row <= h && *offset > 0;
+}
+
+// Writes the checkpoint of the rows written so far, once they are on the
+// disk. The checkpoint is replaced atomically, so a killed job leaves
+// either the previous checkpoint or the new one.
+static void save(struct export * export)
+{
+    if (export->is_png)
+        png_flush(export->png);
+    if (fflush(export->file) != 0 || fsync(fileno(export->file)) != 0)
+        err(EXIT_FAILURE, "%s", export->part);
+
+    char * temporary = sibling(export->checkpoint, ".tmp");
+    FILE * file = fopen(temporary, "w");
+    if (!file)
+        err(EXIT_FAILURE, "%s", temporary);
+    fprintf(file, "%d %d %d %ld %u %s\n", export->w, export->h, export->row,
+            ftell(export->file), export->is_png ? export->png->adler : 0, export->key);
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0 || fclose(file) != 0)
+        err(EXIT_FAILURE, "%s", temporary);
+    if (rename(temporary, export->checkpoint) != 0)
+        err(EXIT_FAILURE, "%s", export->checkpoint);
+
+    free(temporary);
+}
+
+int export_begin(struct export * export, const char * out, int w, int h, const char * key)
+{
+    export->out = out;
+    export->w = w;
+    export->h = h;
+    export->key = key;
+    export->row = 0;
+    export->part = sibling(out, ".part");
+    export->checkpoint = sibling(out, ".checkpoint");
+    export->is_png = has_extension(out, ".png");
+    export->png = malloc(sizeof(struct png_writer));
+    export->rgb = malloc((size_t) w * 3);
+    if (!export->png || !export->rgb)
+        errx(EXIT_FAILURE, "Unable to allocate the image writer");
+
+    // The rows past the checkpoint (of a band being written when the job
+    // was killed) are cut off.
+    int row;
+    long offset;
+    unsigned adler;
+    if (load(export, &row, &offset, &adler) && (export->file = fopen(export->part, "r+b")))
+    {
+        if (ftruncate(fileno(export->file), offset) != 0 || fseek(export->file, offset, SEEK_SET) != 0)
+            err(EXIT_FAILURE, "%s", export->part);
+        if (export->is_png)
+            png_resume(export->png, export->file, w, adler);
+        export->row = row;
+        fprintf(stderr, "resuming %s at row %d of %d\n", out, row, h);
+        return row;
+    }
+
+    export->file = fopen(export->part, "wb");
+    if (!export->file)
+        err(EXIT_FAILURE, "%s", export->part);
+    if (export->is_png)
+        png_begin(export->png, export->file, w, h);
+    else
+        ppm_begin(export->file, w, h);
+
+    return 0;
+}
+
+void export_write(struct export * export, SDL_Surface * surface, int y, int count)
+{
+    unsigned char * rgb = export->rgb;
+
+    SDL_LockSurface(surface);
+    for (int j = y; j < y + count; j++)
+    {
+        const Uint32 * row = (const Uint32 *) ((const Uint8 *) surface->pixels + j * surface->pitch);
+        for (int x = 0; x < export->w; x++)
+            SDL_GetRGB(row[x], surface->format, &rgb[3 * x], &rgb[3 * x + 1], &rgb[3 * x + 2]);
+
+        if (export->is_png)
+            png_write_row(export->png, rgb);
+        else
+            ppm_write_row(export->file, rgb, export->w);
+    }
+    SDL_UnlockSurface(surface);
+
+    export->row += count;
+    save(export);
+}
+
+void export_end(struct export * export)
+{
+    if (export->is_png)
+        png_end(export->png);
+    if (fclose(export->file) != 0)
+        err(EXIT_FAILURE, "%s", export->part);
+
+    if (rename(export->part, export->out) != 0)
+        err(EXIT_FAILURE, "%s", export->out);
+    remove(export->checkpoint);
+
+    free(export->rgb);
+    free(export->png);
+    free(export->checkpoint);
+    free(export->part);
+}
@@ -0,0 +1,43 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <SDL2/SDL.h>
+#include "image.h"
+
+// Streamed export of images too large to be rendered at once (posters of
+// 100000 x 100000 pixels): the image is rendered in bands of rows, and
+// every band is appended to the file then discarded, so the memory does
+// not depend on the height of the image. The file is written as FILE.part
+// and renamed to FILE when complete. After every band, a checkpoint
+// (FILE.checkpoint) records where the file ends, so a job that was killed
+// starts again from its last complete band, if it renders the same image.
+struct export
+{
+    const char * out;
+    int w;
+    int h;
+    const char * key;
+    // Next row of the image.
+    int row;
+
+    char * part;
+    char * checkpoint;
+    FILE * file;
+    int is_png;
+    struct png_writer * png;
+    unsigned char * rgb;
+};
+
+// Opens the export of a w x h image into out (.png or .ppm), from the
+// checkpoint of a previous export of the same image if there is one.
+// key: Parameters of the image (a single line), the checkpoint of an image
+// with other ones is discarded.
+// Returns the first row to render.
+int export_begin(struct export * export, const char * out, int w, int h, const char * key);
+// Appends count rows of a surface (32 bits per pixel), from its row y, to
+// the image, then records a checkpoint.
+void export_write(struct export * export, SDL_Surface * surface, int y, int count);
+// Completes the image once every row was written.
+void export_end(struct export * export);
+
+#endif
@@ -0,0 +1,182 @@
+#include <err.h>
+#include <math.h>
+#include <stdlib.h>
+#include "fractals.h"
+#include "rng.h"
+#include "tiles.h"
+
+// Appends a segment to a list, doubling its capacity when it is full.
+static void push_segment(struct segments * segments, int x1, int y1, int x2, int y2)
+{
+    if (segments->len == segments->cap)
+    {
+        size_t cap = segments->cap ? 2 * segments->cap : 1024;
+        struct segment * data = realloc(segments->data, cap * sizeof(struct segment));
+        if (!data)
+            errx(EXIT_FAILURE, "Unable to allocate the segments");
+        segments->data = data;
+        segments->cap = cap;
+    }
+
+    struct segment * s = &segments->data[segments->len++];
+    s->x1 = x1;
+    s->y1 = y1;
+    s->x2 = x2;
+    s->y2 = y2;
+}
+
+// Makes room for n more vertices in a list.
+static void reserve_points(struct points * points, size_t n)
+{
+    if (points->len + n <= points->cap)
+        return;
+
+    size_t cap = points->cap ? points->cap : 1024;
+    while (cap < points->len + n)
+        cap *= 2;
+
+    struct point * data = realloc(points->data, cap * sizeof(struct point));
+    if (!data)
+        errx(EXIT_FAILURE, "Unable to allocate the points");
+    points->data = data;
+    points->cap = cap;
+}
+
+void segments_clear(struct segments * segments)
+{
+    segments->len = 0;
+}
+
+void segments_free(struct segments * segments)
+{
+    free(segments->data);
+    segments->data = NULL;
+    segments->len = 0;
+    segments->cap = 0;
+}
+
+void points_clear(struct points * points)
+{
+    points->len = 0;
+}
+
+void points_free(struct points * points)
+{
+    free(points->data);
+    points->data = NULL;
+    points->len = 0;
+    points->cap = 0;
+}
+
+static void branches(struct segments * out, int x, int y, double len, double a, int level,
+        int top_level, double step_angle)
+{
+    if (level > top_level)
+        return;
+
+    int x1 = x - len * sin(a + step_angle);
+    int y1 = y - len * cos(a + step_angle);
+    int x2 = x - len * sin(a - step_angle);
+    int y2 = y - len * cos(a - step_angle);
+
+    push_segment(out, x, y, x1, y1);
+    push_segment(out, x, y, x2, y2);
+
+    branches(out, x1, y1, len * CANOPY_RATIO, a + step_angle, level + 1, top_level, step_angle);
+    branches(out, x2, y2, len * CANOPY_RATIO, a - step_angle, level + 1, top_level, step_angle);
+}
+
+void canopy(struct segments * out, int x, int y, double trunk, double len,
+        int top_level, double step_angle)
+{
+    int y1 = y - trunk;
+
+    push_segment(out, x, y, x, y1);
+    branches(out, x, y1, len, 0, 1, top_level, step_angle);
+}
+
+// Midpoint displacement of one depth of the mountain.
+struct displacement
+{
+    struct point * points;
+    size_t stride;
+    int depth;
+    uint64_t seed;
+};
+
+// Displaces the middles of the segments x to x + w - 1 of a depth (tile
+// function, the segments being laid out as a single row).
+static void displace(void * data, int x, int y, int w, int h)
+{
+    const struct displacement * d = data;
+    (void) y;
+    (void) h;
+
+    for (int i = x; i < x + w; i++)
+    {
+        const struct point * a = &d->points[i * d->stride];
+        const struct point * b = &d->points[(i + 1) * d->stride];
+        struct point * mid = &d->points[i * d->stride + d->stride / 2];
+
+        int range = abs(b->x - a->x)/5 + 20;
+        mid->x = (a->x + b->x)/2;
+        mid->y = (a->y + b->y)/2 + (int) (rng_at(d->seed, d->depth, i) % range);
+    }
+}
+
+void mountain(struct points * out, int x, int y, int z, int t, int level, uint64_t seed)
+{
+    size_t count = (size_t) 1 << level;
+    reserve_points(out, count + 1);
+
+    // The vertices are computed in place, depth by depth: the middles of
+    // depth d are spaced by 2^(level - d).
+    struct point * points = out->data + out->len;
+    points[0].x = x;
+    points[0].y = y;
+    points[count].x = z;
+    points[count].y = t;
+    out->len += count + 1;
+
+    for (int depth = 0; depth < level; depth++)
+    {
+        struct displacement d = { points, count >> depth, depth, seed };
+        int segments = 1 << depth;
+        if (segments > MOUNTAIN_PARALLEL)
+            render_tiles(segments, 1, displace, &d);
+        else
+            displace(&d, 0, 0, segments, 1);
+    }
+}
+
+void carpet_axis(signed char * out, int n, int limit)
+{
+    // Sides of the squares of every level, down to the leaves.
+    int sides[32];
+    int depth = 0;
+    sides[0] = n;
+    while (sides[depth] > limit && sides[depth] > 0)
+    {
+        sides[depth + 1] = sides[depth] / 3;
+        depth++;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        // The carpet is a single white square.
+        int position = 1;
+        int offset = i;
+
+        // Position of the pixel in the parent of every level.
+        for (int k = 1; k <= depth && position != CARPET_UNTOUCHED; k++)
+            if (offset >= 3 * sides[k])
+                position = CARPET_UNTOUCHED;
+            else
+            {
+                position = offset / sides[k];
+                offset -= position * sides[k];
+            }
+
+        out[i] = position;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef FRACTALS_H
+#define FRACTALS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Generators of the line and square fractals. They do not depend on SDL:
+// every generator appends the geometry of a fractal to a list (or describes
+// the pixels of the carpet), which is then drawn by the presentation layer
+// (see present.h).
+
+// Segment from (x1, y1) to (x2, y2), in pixels.
+struct segment
+{
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+};
+
+// Growable list of segments, reused from frame to frame.
+struct segments
+{
+    struct segment * data;
+    size_t len;
+    size_t cap;
+};
+
+// Vertex of a polyline, in pixels (same layout as SDL_Point).
+struct point
+{
+    int x;
+    int y;
+};
+
+// Growable list of vertices, reused from frame to frame.
+struct points
+{
+    struct point * data;
+    size_t len;
+    size_t cap;
+};
+
+// Number of segments of a depth of the mountain above which they are
+// displaced on the tile pool.
+#define MOUNTAIN_PARALLEL 4096
+
+// Position of carpet_axis() of the pixels left untouched.
+#define CARPET_UNTOUCHED -1
+
+// Ratio between the length of a branch of the canopy and of its parent.
+#define CANOPY_RATIO 0.7
+
+// Empties a list (its memory is kept for the next frame).
+void segments_clear(struct segments * segments);
+// Frees the memory of a list.
+void segments_free(struct segments * segments);
+// Empties a list (its memory is kept for the next frame).
+void points_clear(struct points * points);
+// Frees the memory of a list.
+void points_free(struct points * points);
+
+// Fractal canopy: a vertical trunk of length trunk going up from (x, y),
+// then two branches of length len rotated by step_angle at its end, and so
+// on up to top_level, every level being CANOPY_RATIO times shorter.
+void canopy(struct segments * out, int x, int y, double trunk, double len,
+        int top_level, double step_angle);
+// Mountain profile from (x, y) to (z, t): the middle of the segment is
+// moved down randomly, level times. Its 2^level + 1 vertices are appended,
+// to be drawn as a single polyline (the dragon and Levy curves are
+// generated by lsystem.h).
+// The displacement of a middle only depends on (seed, depth, index of the
+// segment), so a level refines the ridge of the previous one: its vertices
+// are the even vertices of the next level. The depths with more than
+// MOUNTAIN_PARALLEL segments are split on the tile pool (see tiles.h),
+// which must be started for such levels.
+void mountain(struct points * out, int x, int y, int z, int t, int level, uint64_t seed);
+// Sierpinski carpet of side n: a square of side at most limit is painted
+// with its color (black or white), a larger one is split into 9 squares of
+// side n / 3 (the remainder of the division being left untouched), whose
+// center is white and the others black. The carpet is white if n <= limit.
+// As all the squares of a level have the same side, the carpet is the
+// product of two decompositions of [0, n): out[i] is the position (0, 1 or
+// 2) of pixel i in the parent of its leaf, or CARPET_UNTOUCHED. A pixel is
+// white iff both its positions are 1 (every position is 1 if n <= limit).
+void carpet_axis(signed char * out, int n, int limit);
+
+#endif
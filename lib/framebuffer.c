@@ -0,0 +1,57 @@
+#include <err.h>
+#include <stdlib.h>
+#include "framebuffer.h"
+
+void framebuffer_init(struct framebuffer * framebuffer)
+{
+    framebuffer->surface = NULL;
+    framebuffer->w = 0;
+    framebuffer->h = 0;
+}
+
+void framebuffer_free(struct framebuffer * framebuffer)
+{
+    if (framebuffer->surface)
+        SDL_FreeSurface(framebuffer->surface);
+    framebuffer->surface = NULL;
+}
+
+// Capacity of a side of the surface for frames of side n.
+//
+// capacity: Current capacity.
+// n: Side of the frames.
+static int grow(int capacity, int n)
+{
+    if (n <= capacity)
+        return capacity;
+
+    int larger = capacity + capacity / 2;
+    return n > larger ? n : larger;
+}
+
+SDL_Surface * framebuffer_get(struct framebuffer * framebuffer, int w, int h)
+{
+    SDL_Surface * surface = framebuffer->surface;
+
+    if (surface == NULL || w > surface->w || h > surface->h)
+    {
+        int cw = grow(surface ? surface->w : 0, w);
+        int ch = grow(surface ? surface->h : 0, h);
+
+        framebuffer_free(framebuffer);
+        surface = SDL_CreateRGBSurface(0, cw, ch, 32, 0, 0, 0, 0);
+        if (!surface)
+            errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+        framebuffer->surface = surface;
+    }
+    else if (w != framebuffer->w || h != framebuffer->h)
+    {
+        SDL_Rect rect = { 0, 0, w, h };
+        SDL_FillRect(surface, &rect, SDL_MapRGB(surface->format, 0, 0, 0));
+    }
+
+    framebuffer->w = w;
+    framebuffer->h = h;
+    return surface;
+}
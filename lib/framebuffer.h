@@ -0,0 +1,27 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <SDL2/SDL.h>
+
+// Surface of the frames of a window, reused from frame to frame: it only
+// grows, by half its size at least (so that dragging the border of the
+// window does not reallocate it at every step), and a smaller frame uses
+// its top left part.
+struct framebuffer
+{
+    SDL_Surface * surface;
+    // Size of the last frame.
+    int w;
+    int h;
+};
+
+// Initializes a framebuffer (the surface is created by the first frame).
+void framebuffer_init(struct framebuffer * framebuffer);
+// Frees the surface of a framebuffer.
+void framebuffer_free(struct framebuffer * framebuffer);
+// Returns a surface of at least w x h (32 bits). When the size of the
+// frames changes, its w x h top left part is cleared in black, as a new
+// surface would be.
+SDL_Surface * framebuffer_get(struct framebuffer * framebuffer, int w, int h);
+
+#endif
@@ -0,0 +1,90 @@
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headless.h"
+#include "image.h"
+
+int headless_parse(struct headless * headless, int argc, char * argv[], int w, int h)
+{
+    int n = 1;
+
+    headless->enabled = 0;
+    headless->out = NULL;
+    headless->w = w;
+    headless->h = h;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless->enabled = 1;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            headless->out = argv[++i];
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &headless->w, &headless->h) != 2
+                    || headless->w <= 0 || headless->h <= 0)
+                errx(EXIT_FAILURE, "Invalid size: %s (expected WxH)", argv[i]);
+        }
+        else
+            argv[n++] = argv[i];
+    }
+    argv[n] = NULL;
+
+    if (headless->enabled && headless->out == NULL)
+        errx(EXIT_FAILURE, "--headless requires --out FILE");
+    if (headless->out && !has_extension(headless->out, ".png")
+            && !has_extension(headless->out, ".ppm"))
+        errx(EXIT_FAILURE, "Unsupported image format: %s (expected .png or .ppm)", headless->out);
+
+    return n;
+}
+
+SDL_Surface * headless_surface(const struct headless * headless)
+{
+    SDL_Surface * surface = SDL_CreateRGBSurface(0, headless->w, headless->h, 32, 0, 0, 0, 0);
+    if (!surface)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    return surface;
+}
+
+void headless_write(const struct headless * headless, SDL_Surface * surface)
+{
+    FILE * file = fopen(headless->out, "wb");
+    if (!file)
+        err(EXIT_FAILURE, "%s", headless->out);
+
+    unsigned char * rgb = malloc((size_t) surface->w * 3);
+    struct png_writer * png = malloc(sizeof(struct png_writer));
+    if (!rgb || !png)
+        errx(EXIT_FAILURE, "Unable to allocate the image writer");
+
+    int is_png = has_extension(headless->out, ".png");
+    if (is_png)
+        png_begin(png, file, surface->w, surface->h);
+    else
+        ppm_begin(file, surface->w, surface->h);
+
+    SDL_LockSurface(surface);
+    for (int y = 0; y < surface->h; y++)
+    {
+        const Uint32 * row = (const Uint32 *) ((const Uint8 *) surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; x++)
+            SDL_GetRGB(row[x], surface->format, &rgb[3 * x], &rgb[3 * x + 1], &rgb[3 * x + 2]);
+
+        if (is_png)
+            png_write_row(png, rgb);
+        else
+            ppm_write_row(file, rgb, surface->w);
+    }
+    SDL_UnlockSurface(surface);
+
+    if (is_png)
+        png_end(png);
+    if (fclose(file) != 0)
+        err(EXIT_FAILURE, "%s", headless->out);
+
+    free(png);
+    free(rgb);
+}
@@ -0,0 +1,26 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <SDL2/SDL.h>
+
+// Options of the headless mode, which renders a single frame into an
+// offscreen surface and writes it to a file, without initializing video.
+struct headless
+{
+    int enabled;
+    const char * out;
+    int w;
+    int h;
+};
+
+// Parses --headless, --out FILE (.png or .ppm) and --size WxH, and removes
+// them from the arguments.
+// w and h are the default size of the image.
+// Returns the number of remaining arguments.
+int headless_parse(struct headless * headless, int argc, char * argv[], int w, int h);
+// Creates the offscreen surface of the headless mode (black, 32 bits).
+SDL_Surface * headless_surface(const struct headless * headless);
+// Writes the surface to the output file.
+void headless_write(const struct headless * headless, SDL_Surface * surface);
+
+#endif
@@ -0,0 +1,202 @@
+#include <err.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "image.h"
+
+static uint32_t crc_table[256];
+
+// Computes the CRC-32 table used by the PNG chunks.
+static void crc_init(void)
+{
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const unsigned char * buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        crc = crc_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static uint32_t adler_update(uint32_t adler, const unsigned char * buf, size_t len)
+{
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+
+    while (len)
+    {
+        // 5552 is the largest count that cannot overflow b.
+        size_t n = len < 5552 ? len : 5552;
+        len -= n;
+        while (n--)
+        {
+            a += *buf++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+
+    return (b << 16) | a;
+}
+
+static void put32(unsigned char * p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void write_all(FILE * file, const void * buf, size_t len)
+{
+    if (len && fwrite(buf, 1, len, file) != len)
+        err(EXIT_FAILURE, "Unable to write the image");
+}
+
+// Writes a PNG chunk whose data is the concatenation of head and body.
+static void chunk(FILE * file, const char * type, const unsigned char * head, size_t head_len,
+        const unsigned char * body, size_t body_len)
+{
+    unsigned char buf[4];
+    uint32_t crc = 0xffffffffu;
+
+    put32(buf, head_len + body_len);
+    write_all(file, buf, 4);
+    write_all(file, type, 4);
+    write_all(file, head, head_len);
+    write_all(file, body, body_len);
+
+    crc = crc_update(crc, (const unsigned char *) type, 4);
+    crc = crc_update(crc, head, head_len);
+    crc = crc_update(crc, body, body_len);
+    put32(buf, crc ^ 0xffffffffu);
+    write_all(file, buf, 4);
+}
+
+// Writes the pending pixels as a stored deflate block in an IDAT chunk.
+static void flush_block(struct png_writer * png, int final)
+{
+    unsigned char head[5];
+    head[0] = final ? 1 : 0;
+    head[1] = png->used & 0xff;
+    head[2] = png->used >> 8;
+    head[3] = ~png->used & 0xff;
+    head[4] = (~png->used >> 8) & 0xff;
+
+    chunk(png->file, "IDAT", head, 5, png->block, png->used);
+    png->used = 0;
+}
+
+// Appends bytes to the deflate stream.
+static void append(struct png_writer * png, const unsigned char * buf, size_t len)
+{
+    png->adler = adler_update(png->adler, buf, len);
+
+    while (len)
+    {
+        size_t n = PNG_BLOCK - png->used;
+        if (n > len)
+            n = len;
+        memcpy(png->block + png->used, buf, n);
+        png->used += n;
+        buf += n;
+        len -= n;
+
+        if (png->used == PNG_BLOCK)
+            flush_block(png, 0);
+    }
+}
+
+void png_begin(struct png_writer * png, FILE * file, int w, int h)
+{
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    static const unsigned char zlib[2] = { 0x78, 0x01 };
+    unsigned char ihdr[13];
+
+    crc_init();
+
+    png->file = file;
+    png->w = w;
+    png->adler = 1;
+    png->used = 0;
+
+    put32(ihdr, w);
+    put32(ihdr + 4, h);
+    ihdr[8] = 8;        // Bit depth
+    ihdr[9] = 2;        // RGB
+    ihdr[10] = 0;       // Deflate
+    ihdr[11] = 0;       // Adaptive filtering
+    ihdr[12] = 0;       // No interlace
+
+    write_all(file, signature, 8);
+    chunk(file, "IHDR", ihdr, 13, NULL, 0);
+    chunk(file, "IDAT", zlib, 2, NULL, 0);
+}
+
+void png_write_row(struct png_writer * png, const unsigned char * rgb)
+{
+    static const unsigned char filter = 0;
+
+    append(png, &filter, 1);
+    append(png, rgb, (size_t) png->w * 3);
+}
+
+void png_flush(struct png_writer * png)
+{
+    if (png->used)
+        flush_block(png, 0);
+}
+
+void png_resume(struct png_writer * png, FILE * file, int w, uint32_t adler)
+{
+    crc_init();
+
+    png->file = file;
+    png->w = w;
+    png->adler = adler;
+    png->used = 0;
+}
+
+void png_end(struct png_writer * png)
+{
+    unsigned char adler[4];
+
+    flush_block(png, 1);
+    put32(adler, png->adler);
+    chunk(png->file, "IDAT", adler, 4, NULL, 0);
+    chunk(png->file, "IEND", NULL, 0, NULL, 0);
+}
+
+void ppm_begin(FILE * file, int w, int h)
+{
+    if (fprintf(file, "P6\n%d %d\n255\n", w, h) < 0)
+        err(EXIT_FAILURE, "Unable to write the image");
+}
+
+void ppm_write_row(FILE * file, const unsigned char * rgb, int w)
+{
+    write_all(file, rgb, (size_t) w * 3);
+}
+
+int has_extension(const char * path, const char * ext)
+{
+    size_t len = strlen(path);
+    size_t ext_len = strlen(ext);
+
+    if (len < ext_len)
+        return 0;
+
+    for (size_t i = 0; i < ext_len; i++)
+        if (tolower((unsigned char) path[len - ext_len + i]) != tolower((unsigned char) ext[i]))
+            return 0;
+
+    return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Size of the deflate blocks (and IDAT chunks) of the PNG writer.
+#define PNG_BLOCK 65535
+
+// Streaming PNG writer (8-bit RGB, no compression: the pixels are stored
+// in raw deflate blocks, so no external library is needed).
+struct png_writer
+{
+    FILE * file;
+    int w;
+    uint32_t adler;
+    size_t used;
+    unsigned char block[PNG_BLOCK];
+};
+
+// Writes the PNG signature and header of a w x h image.
+void png_begin(struct png_writer * png, FILE * file, int w, int h);
+// Appends a row of w RGB pixels (3 bytes per pixel).
+void png_write_row(struct png_writer * png, const unsigned char * rgb);
+// Writes the pending pixels, so that the file ends after the last row
+// appended (the image can be continued from there by png_resume()).
+void png_flush(struct png_writer * png);
+// Continues an image of width w written up to a png_flush(), file being
+// positioned at its end: adler is the checksum of its pixels.
+void png_resume(struct png_writer * png, FILE * file, int w, uint32_t adler);
+// Flushes the pending pixels and writes the end of the image.
+void png_end(struct png_writer * png);
+
+// Writes the header of a binary PPM (P6) image.
+void ppm_begin(FILE * file, int w, int h);
+// Appends a row of w RGB pixels.
+void ppm_write_row(FILE * file, const unsigned char * rgb, int w);
+
+// Whether a path ends with the given extension (case insensitive).
+int has_extension(const char * path, const char * ext);
+
+#endif
@@ -0,0 +1,649 @@
+// The vector kernels perform exactly the same floating point operations,
+// in the same order, as the scalar one, so that the iteration counts are
+// bit-identical. This file must be built with -ffp-contract=off so that
+// the compiler does not fuse them into FMAs.
+//
+// Interior points never escape, so they are detected instead of being
+// iterated up to iter:
+// - the main cardioid and the period-2 bulb are tested before iterating;
+// - the orbit is compared (exactly) with a checkpoint after every
+//   iteration, and the checkpoint is moved after 8, 16, 32... iterations
+//   (Brent): an orbit that comes back to it is periodic.
+// Both checks are done the same way in every kernel.
+
+#include <math.h>
+#include <string.h>
+#include "escape.h"
+#include "kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNEL_X86
+#endif
+
+// Number of iterations before the first move of the periodicity checkpoint.
+#define PERIOD 8
+
+// Number of points of a call to the resumable kernel by mandelbrot_smooth().
+#define SMOOTH_CHUNK 64
+// Iterations past the escape of the normalized iteration counts.
+#define SMOOTH_EXTRA 4
+
+kernel_func mandelbrot_points;
+resume_func mandelbrot_resume;
+static const char * name = "scalar";
+
+// Whether c = x0 + i * y0 is in the main cardioid or in the period-2 bulb.
+static int interior(double x0, double y0)
+{
+    double yy = y0*y0;
+    double xq = x0 - 0.25;
+    double q = xq*xq + yy;
+    double xb = x0 + 1;
+    return q*(q + xq) <= 0.25*yy || xb*xb + yy <= 0.0625;
+}
+
+// Iterates a point from z = *zx + i * *zy after n iterations, and adds the
+// iterations avoided by the interior checks to *skipped.
+static int iterate(double x0, double y0, double * zx, double * zy, int n, int iter,
+        long * skipped)
+{
+    if (n < iter && interior(x0, y0))
+    {
+        *skipped += iter - n;
+        return iter;
+    }
+
+    double tmp;
+    double x = *zx, y = *zy;
+    double hx = x, hy = y;
+    int since = 0, period = PERIOD;
+    while (x*x + y*y <= 4 && n < iter)
+    {
+        tmp = x*x - y*y + x0;
+        y = 2*x*y + y0;
+        x = tmp;
+        n++;
+
+        if (x == hx && y == hy)
+        {
+            *skipped += iter - n;
+            n = iter;
+            break;
+        }
+        if (++since == period)
+        {
+            hx = x;
+            hy = y;
+            since = 0;
+            period *= 2;
+        }
+    }
+    *zx = x;
+    *zy = y;
+    return n;
+}
+
+int mandelbrot_resume_point(double x0, double y0, double * zx, double * zy, int n, int iter)
+{
+    long skipped = 0;
+    return iterate(x0, y0, zx, zy, n, iter, &skipped);
+}
+
+int mandelbrot_point(double x0, double y0, int iter)
+{
+    double x = 0, y = 0;
+    return mandelbrot_resume_point(x0, y0, &x, &y, 0, iter);
+}
+
+static long points_scalar(const double * cx, const double * cy, int count, int iter, int * out)
+{
+    long skipped = 0;
+    for (int i = 0; i < count; i++)
+    {
+        double x = 0, y = 0;
+        out[i] = iterate(cx[i], cy[i], &x, &y, 0, iter, &skipped);
+    }
+    return skipped;
+}
+
+static long resume_scalar(const double * cx, const double * cy, double * zx, double * zy,
+        int * n, int count, int iter)
+{
+    long skipped = 0;
+    for (int i = 0; i < count; i++)
+        n[i] = iterate(cx[i], cy[i], &zx[i], &zy[i], n[i], iter, &skipped);
+    return skipped;
+}
+
+#ifdef KERNEL_X86
+
+// Vector versions of interior(): all bits set in the lanes inside the main
+// cardioid or the period-2 bulb.
+
+__attribute__((target("sse2")))
+static inline __m128d interior_sse2(__m128d x0, __m128d y0)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    const __m128d sixteenth = _mm_set1_pd(0.0625);
+    const __m128d one = _mm_set1_pd(1.0);
+
+    __m128d yy = _mm_mul_pd(y0, y0);
+    __m128d xq = _mm_sub_pd(x0, quarter);
+    __m128d q = _mm_add_pd(_mm_mul_pd(xq, xq), yy);
+    __m128d xb = _mm_add_pd(x0, one);
+    return _mm_or_pd(_mm_cmple_pd(_mm_mul_pd(q, _mm_add_pd(q, xq)), _mm_mul_pd(quarter, yy)),
+            _mm_cmple_pd(_mm_add_pd(_mm_mul_pd(xb, xb), yy), sixteenth));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d interior_avx2(__m256d x0, __m256d y0)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d sixteenth = _mm256_set1_pd(0.0625);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    __m256d yy = _mm256_mul_pd(y0, y0);
+    __m256d xq = _mm256_sub_pd(x0, quarter);
+    __m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), yy);
+    __m256d xb = _mm256_add_pd(x0, one);
+    return _mm256_or_pd(
+            _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xq)), _mm256_mul_pd(quarter, yy),
+                _CMP_LE_OQ),
+            _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(xb, xb), yy), sixteenth, _CMP_LE_OQ));
+}
+
+__attribute__((target("avx512f")))
+static inline __mmask8 interior_avx512(__m512d x0, __m512d y0)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512d sixteenth = _mm512_set1_pd(0.0625);
+    const __m512d one = _mm512_set1_pd(1.0);
+
+    __m512d yy = _mm512_mul_pd(y0, y0);
+    __m512d xq = _mm512_sub_pd(x0, quarter);
+    __m512d q = _mm512_add_pd(_mm512_mul_pd(xq, xq), yy);
+    __m512d xb = _mm512_add_pd(x0, one);
+    return _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xq)), _mm512_mul_pd(quarter, yy),
+                _CMP_LE_OQ)
+        | _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(xb, xb), yy), sixteenth, _CMP_LE_OQ);
+}
+
+// Lanes are retired with a mask as soon as they escape or cycle; the loop
+// ends when every lane is retired or iter iterations have been done. All
+// the lanes start at 0, so a lane that cycles after k iterations skips
+// iter - k of them.
+
+__attribute__((target("sse2")))
+static long points_sse2(const double * cx, const double * cy, int count, int iter, int * out)
+{
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128i limit = _mm_set1_epi64x(iter);
+    long skipped = 0;
+    int i = 0;
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d x0 = _mm_loadu_pd(cx + i);
+        __m128d y0 = _mm_loadu_pd(cy + i);
+        __m128d x = _mm_setzero_pd();
+        __m128d y = _mm_setzero_pd();
+        __m128d hx = x, hy = y;
+        __m128d inside = interior_sse2(x0, y0);
+        __m128d active = _mm_andnot_pd(inside, _mm_castsi128_pd(_mm_set1_epi32(-1)));
+        __m128i n = _mm_and_si128(_mm_castpd_si128(inside), limit);
+        int since = 0, period = PERIOD;
+
+        skipped += (long) __builtin_popcount(_mm_movemask_pd(inside)) * iter;
+
+        for (int k = 0; k < iter; k++)
+        {
+            __m128d xx = _mm_mul_pd(x, x);
+            __m128d yy = _mm_mul_pd(y, y);
+            active = _mm_and_pd(active, _mm_cmple_pd(_mm_add_pd(xx, yy), four));
+            if (!_mm_movemask_pd(active))
+                break;
+            n = _mm_sub_epi64(n, _mm_castpd_si128(active));
+
+            __m128d tmp = _mm_add_pd(_mm_sub_pd(xx, yy), x0);
+            y = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, x), y), y0);
+            x = tmp;
+
+            __m128d cycle = _mm_and_pd(active,
+                    _mm_and_pd(_mm_cmpeq_pd(x, hx), _mm_cmpeq_pd(y, hy)));
+            int mask = _mm_movemask_pd(cycle);
+            if (mask)
+            {
+                __m128i keep = _mm_castpd_si128(cycle);
+                n = _mm_or_si128(_mm_and_si128(keep, limit), _mm_andnot_si128(keep, n));
+                active = _mm_andnot_pd(cycle, active);
+                skipped += (long) __builtin_popcount(mask) * (iter - k - 1);
+            }
+            if (++since == period)
+            {
+                hx = x;
+                hy = y;
+                since = 0;
+                period *= 2;
+            }
+        }
+
+        long long counts[2];
+        _mm_storeu_si128((__m128i *) counts, n);
+        out[i] = counts[0];
+        out[i + 1] = counts[1];
+    }
+
+    return skipped + points_scalar(cx + i, cy + i, count - i, iter, out + i);
+}
+
+__attribute__((target("avx2")))
+static long points_avx2(const double * cx, const double * cy, int count, int iter, int * out)
+{
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256i limit = _mm256_set1_epi64x(iter);
+    long skipped = 0;
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d x0 = _mm256_loadu_pd(cx + i);
+        __m256d y0 = _mm256_loadu_pd(cy + i);
+        __m256d x = _mm256_setzero_pd();
+        __m256d y = _mm256_setzero_pd();
+        __m256d hx = x, hy = y;
+        __m256d inside = interior_avx2(x0, y0);
+        __m256d active = _mm256_andnot_pd(inside, _mm256_castsi256_pd(_mm256_set1_epi32(-1)));
+        __m256i n = _mm256_and_si256(_mm256_castpd_si256(inside), limit);
+        int since = 0, period = PERIOD;
+
+        skipped += (long) __builtin_popcount(_mm256_movemask_pd(inside)) * iter;
+
+        for (int k = 0; k < iter; k++)
+        {
+            __m256d xx = _mm256_mul_pd(x, x);
+            __m256d yy = _mm256_mul_pd(y, y);
+            active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_add_pd(xx, yy), four, _CMP_LE_OQ));
+            if (!_mm256_movemask_pd(active))
+                break;
+            n = _mm256_sub_epi64(n, _mm256_castpd_si256(active));
+
+            __m256d tmp = _mm256_add_pd(_mm256_sub_pd(xx, yy), x0);
+            y = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, x), y), y0);
+            x = tmp;
+
+            __m256d cycle = _mm256_and_pd(active, _mm256_and_pd(
+                    _mm256_cmp_pd(x, hx, _CMP_EQ_OQ), _mm256_cmp_pd(y, hy, _CMP_EQ_OQ)));
+            int mask = _mm256_movemask_pd(cycle);
+            if (mask)
+            {
+                n = _mm256_blendv_epi8(n, limit, _mm256_castpd_si256(cycle));
+                active = _mm256_andnot_pd(cycle, active);
+                skipped += (long) __builtin_popcount(mask) * (iter - k - 1);
+            }
+            if (++since == period)
+            {
+                hx = x;
+                hy = y;
+                since = 0;
+                period *= 2;
+            }
+        }
+
+        long long counts[4];
+        _mm256_storeu_si256((__m256i *) counts, n);
+        for (int l = 0; l < 4; l++)
+            out[i + l] = counts[l];
+    }
+
+    return skipped + points_sse2(cx + i, cy + i, count - i, iter, out + i);
+}
+
+__attribute__((target("avx512f")))
+static long points_avx512(const double * cx, const double * cy, int count, int iter, int * out)
+{
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i limit = _mm512_set1_epi64(iter);
+    long skipped = 0;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512d x0 = _mm512_loadu_pd(cx + i);
+        __m512d y0 = _mm512_loadu_pd(cy + i);
+        __m512d x = _mm512_setzero_pd();
+        __m512d y = _mm512_setzero_pd();
+        __m512d hx = x, hy = y;
+        __mmask8 inside = interior_avx512(x0, y0);
+        __mmask8 active = ~inside;
+        __m512i n = _mm512_maskz_mov_epi64(inside, limit);
+        int since = 0, period = PERIOD;
+
+        skipped += (long) __builtin_popcount(inside) * iter;
+
+        for (int k = 0; k < iter; k++)
+        {
+            __m512d xx = _mm512_mul_pd(x, x);
+            __m512d yy = _mm512_mul_pd(y, y);
+            active &= _mm512_cmp_pd_mask(_mm512_add_pd(xx, yy), four, _CMP_LE_OQ);
+            if (!active)
+                break;
+            n = _mm512_mask_add_epi64(n, active, n, one);
+
+            __m512d tmp = _mm512_add_pd(_mm512_sub_pd(xx, yy), x0);
+            y = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, x), y), y0);
+            x = tmp;
+
+            __mmask8 cycle = active & _mm512_cmp_pd_mask(x, hx, _CMP_EQ_OQ)
+                & _mm512_cmp_pd_mask(y, hy, _CMP_EQ_OQ);
+            if (cycle)
+            {
+                n = _mm512_mask_mov_epi64(n, cycle, limit);
+                active &= ~cycle;
+                skipped += (long) __builtin_popcount(cycle) * (iter - k - 1);
+            }
+            if (++since == period)
+            {
+                hx = x;
+                hy = y;
+                since = 0;
+                period *= 2;
+            }
+        }
+
+        _mm256_storeu_si256((__m256i *) (out + i), _mm512_cvtepi64_epi32(n));
+    }
+
+    return skipped + points_avx2(cx + i, cy + i, count - i, iter, out + i);
+}
+
+// The resumable kernels start with a different count in every lane, so the
+// counts are kept as doubles (exact below 2^53) to compare them with iter,
+// and the orbits of retired lanes are preserved with a blend. A lane
+// detected as interior jumps to iter, which retires it, and the skipped
+// iterations (iter - count) are summed per lane.
+
+__attribute__((target("sse2")))
+static long resume_sse2(const double * cx, const double * cy, double * zx, double * zy,
+        int * n, int count, int iter)
+{
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d limit = _mm_set1_pd(iter);
+    __m128d saved = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d x0 = _mm_loadu_pd(cx + i);
+        __m128d y0 = _mm_loadu_pd(cy + i);
+        __m128d x = _mm_loadu_pd(zx + i);
+        __m128d y = _mm_loadu_pd(zy + i);
+        __m128d hx = x, hy = y;
+        __m128d m = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) (n + i)));
+        __m128d active = _mm_castsi128_pd(_mm_set1_epi32(-1));
+        int since = 0, period = PERIOD;
+
+        __m128d inside = _mm_and_pd(interior_sse2(x0, y0), _mm_cmplt_pd(m, limit));
+        saved = _mm_add_pd(saved, _mm_and_pd(inside, _mm_sub_pd(limit, m)));
+        m = _mm_or_pd(_mm_and_pd(inside, limit), _mm_andnot_pd(inside, m));
+
+        while (1)
+        {
+            __m128d xx = _mm_mul_pd(x, x);
+            __m128d yy = _mm_mul_pd(y, y);
+            active = _mm_and_pd(active, _mm_and_pd(_mm_cmple_pd(_mm_add_pd(xx, yy), four),
+                    _mm_cmplt_pd(m, limit)));
+            if (!_mm_movemask_pd(active))
+                break;
+            m = _mm_add_pd(m, _mm_and_pd(active, one));
+
+            __m128d tmp = _mm_add_pd(_mm_sub_pd(xx, yy), x0);
+            __m128d ny = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, x), y), y0);
+            x = _mm_or_pd(_mm_and_pd(active, tmp), _mm_andnot_pd(active, x));
+            y = _mm_or_pd(_mm_and_pd(active, ny), _mm_andnot_pd(active, y));
+
+            __m128d cycle = _mm_and_pd(active,
+                    _mm_and_pd(_mm_cmpeq_pd(x, hx), _mm_cmpeq_pd(y, hy)));
+            if (_mm_movemask_pd(cycle))
+            {
+                saved = _mm_add_pd(saved, _mm_and_pd(cycle, _mm_sub_pd(limit, m)));
+                m = _mm_or_pd(_mm_and_pd(cycle, limit), _mm_andnot_pd(cycle, m));
+            }
+            if (++since == period)
+            {
+                hx = x;
+                hy = y;
+                since = 0;
+                period *= 2;
+            }
+        }
+
+        _mm_storeu_pd(zx + i, x);
+        _mm_storeu_pd(zy + i, y);
+        _mm_storel_epi64((__m128i *) (n + i), _mm_cvtpd_epi32(m));
+    }
+
+    double sums[2];
+    _mm_storeu_pd(sums, saved);
+    return (long) (sums[0] + sums[1])
+        + resume_scalar(cx + i, cy + i, zx + i, zy + i, n + i, count - i, iter);
+}
+
+__attribute__((target("avx2")))
+static long resume_avx2(const double * cx, const double * cy, double * zx, double * zy,
+        int * n, int count, int iter)
+{
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d limit = _mm256_set1_pd(iter);
+    __m256d saved = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d x0 = _mm256_loadu_pd(cx + i);
+        __m256d y0 = _mm256_loadu_pd(cy + i);
+        __m256d x = _mm256_loadu_pd(zx + i);
+        __m256d y = _mm256_loadu_pd(zy + i);
+        __m256d hx = x, hy = y;
+        __m256d m = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) (n + i)));
+        __m256d active = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+        int since = 0, period = PERIOD;
+
+        __m256d inside = _mm256_and_pd(interior_avx2(x0, y0),
+                _mm256_cmp_pd(m, limit, _CMP_LT_OQ));
+        saved = _mm256_add_pd(saved, _mm256_and_pd(inside, _mm256_sub_pd(limit, m)));
+        m = _mm256_blendv_pd(m, limit, inside);
+
+        while (1)
+        {
+            __m256d xx = _mm256_mul_pd(x, x);
+            __m256d yy = _mm256_mul_pd(y, y);
+            active = _mm256_and_pd(active, _mm256_and_pd(
+                    _mm256_cmp_pd(_mm256_add_pd(xx, yy), four, _CMP_LE_OQ),
+                    _mm256_cmp_pd(m, limit, _CMP_LT_OQ)));
+            if (!_mm256_movemask_pd(active))
+                break;
+            m = _mm256_add_pd(m, _mm256_and_pd(active, one));
+
+            __m256d tmp = _mm256_add_pd(_mm256_sub_pd(xx, yy), x0);
+            __m256d ny = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, x), y), y0);
+            x = _mm256_blendv_pd(x, tmp, active);
+            y = _mm256_blendv_pd(y, ny, active);
+
+            __m256d cycle = _mm256_and_pd(active, _mm256_and_pd(
+                    _mm256_cmp_pd(x, hx, _CMP_EQ_OQ), _mm256_cmp_pd(y, hy, _CMP_EQ_OQ)));
+            if (_mm256_movemask_pd(cycle))
+            {
+                saved = _mm256_add_pd(saved, _mm256_and_pd(cycle, _mm256_sub_pd(limit, m)));
+                m = _mm256_blendv_pd(m, limit, cycle);
+            }
+            if (++since == period)
+            {
+                hx = x;
+                hy = y;
+                since = 0;
+                period *= 2;
+            }
+        }
+
+        _mm256_storeu_pd(zx + i, x);
+        _mm256_storeu_pd(zy + i, y);
+        _mm_storeu_si128((__m128i *) (n + i), _mm256_cvtpd_epi32(m));
+    }
+
+    double sums[4];
+    _mm256_storeu_pd(sums, saved);
+    return (long) (sums[0] + sums[1] + sums[2] + sums[3])
+        + resume_sse2(cx + i, cy + i, zx + i, zy + i, n + i, count - i, iter);
+}
+
+__attribute__((target("avx512f")))
+static long resume_avx512(const double * cx, const double * cy, double * zx, double * zy,
+        int * n, int count, int iter)
+{
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d limit = _mm512_set1_pd(iter);
+    __m512d saved = _mm512_setzero_pd();
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512d x0 = _mm512_loadu_pd(cx + i);
+        __m512d y0 = _mm512_loadu_pd(cy + i);
+        __m512d x = _mm512_loadu_pd(zx + i);
+        __m512d y = _mm512_loadu_pd(zy + i);
+        __m512d hx = x, hy = y;
+        __m512d m = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i *) (n + i)));
+        __mmask8 active = 0xff;
+        int since = 0, period = PERIOD;
+
+        __mmask8 inside = interior_avx512(x0, y0) & _mm512_cmp_pd_mask(m, limit, _CMP_LT_OQ);
+        saved = _mm512_mask_add_pd(saved, inside, saved, _mm512_sub_pd(limit, m));
+        m = _mm512_mask_mov_pd(m, inside, limit);
+
+        while (1)
+        {
+            __m512d xx = _mm512_mul_pd(x, x);
+            __m512d yy = _mm512_mul_pd(y, y);
+            active &= _mm512_cmp_pd_mask(_mm512_add_pd(xx, yy), four, _CMP_LE_OQ);
+            active &= _mm512_cmp_pd_mask(m, limit, _CMP_LT_OQ);
+            if (!active)
+                break;
+            m = _mm512_mask_add_pd(m, active, m, one);
+
+            __m512d tmp = _mm512_add_pd(_mm512_sub_pd(xx, yy), x0);
+            __m512d ny = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, x), y), y0);
+            x = _mm512_mask_mov_pd(x, active, tmp);
+            y = _mm512_mask_mov_pd(y, active, ny);
+
+            __mmask8 cycle = active & _mm512_cmp_pd_mask(x, hx, _CMP_EQ_OQ)
+                & _mm512_cmp_pd_mask(y, hy, _CMP_EQ_OQ);
+            if (cycle)
+            {
+                saved = _mm512_mask_add_pd(saved, cycle, saved, _mm512_sub_pd(limit, m));
+                m = _mm512_mask_mov_pd(m, cycle, limit);
+            }
+            if (++since == period)
+            {
+                hx = x;
+                hy = y;
+                since = 0;
+                period *= 2;
+            }
+        }
+
+        _mm512_storeu_pd(zx + i, x);
+        _mm512_storeu_pd(zy + i, y);
+        _mm256_storeu_si256((__m256i *) (n + i), _mm512_cvtpd_epi32(m));
+    }
+
+    return (long) _mm512_reduce_add_pd(saved)
+        + resume_avx2(cx + i, cy + i, zx + i, zy + i, n + i, count - i, iter);
+}
+
+#endif
+
+void kernel_init(void)
+{
+    escape_init();
+
+    mandelbrot_points = points_scalar;
+    mandelbrot_resume = resume_scalar;
+    name = "scalar";
+
+#ifdef KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2"))
+    {
+        mandelbrot_points = points_avx512;
+        mandelbrot_resume = resume_avx512;
+        name = "avx512";
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        mandelbrot_points = points_avx2;
+        mandelbrot_resume = resume_avx2;
+        name = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        mandelbrot_points = points_sse2;
+        mandelbrot_resume = resume_sse2;
+        name = "sse2";
+    }
+#endif
+}
+
+const char * kernel_name(void)
+{
+    return name;
+}
+
+float mandelbrot_smooth_count(double cx, double cy, int n, double zx, double zy)
+{
+    if (zx*zx + zy*zy <= 4)
+        return (float) n;
+
+    // log2(log2(|z|)) grows by about 1 per iteration once |z| is large,
+    // which the escape radius of 2 is not.
+    for (int i = 0; i < SMOOTH_EXTRA; i++)
+    {
+        double tmp = zx*zx - zy*zy + cx;
+        zy = 2*zx*zy + cy;
+        zx = tmp;
+    }
+
+    double count = n + 1 - log2(0.5 * log2(zx*zx + zy*zy)) + SMOOTH_EXTRA;
+    return count > 0 ? (float) count : 0;
+}
+
+long mandelbrot_smooth(const double * cx, const double * cy, int count, int iter, float * out)
+{
+    double zx[SMOOTH_CHUNK];
+    double zy[SMOOTH_CHUNK];
+    int n[SMOOTH_CHUNK];
+    long skipped = 0;
+
+    for (int i = 0; i < count; i += SMOOTH_CHUNK)
+    {
+        int len = count - i < SMOOTH_CHUNK ? count - i : SMOOTH_CHUNK;
+        memset(zx, 0, len * sizeof(double));
+        memset(zy, 0, len * sizeof(double));
+        memset(n, 0, len * sizeof(int));
+
+        skipped += mandelbrot_resume(cx + i, cy + i, zx, zy, n, len, iter);
+        for (int k = 0; k < len; k++)
+            out[i + k] = mandelbrot_smooth_count(cx[i + k], cy[i + k], n[k], zx[k], zy[k]);
+    }
+    return skipped;
+}
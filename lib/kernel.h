@@ -0,0 +1,47 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+// Escape-time kernel: computes the number of iterations of z = z^2 + c
+// (z starting at 0) before |z| > 2, bounded by iter, for count points
+// c = cx[i] + i * cy[i], and stores them in out.
+// Returns the number of iterations skipped by the interior checks (points
+// in the main cardioid, in the period-2 bulb, or with a periodic orbit).
+typedef long (*kernel_func)(const double * cx, const double * cy, int count, int iter, int * out);
+
+// Resumable kernel: continues the orbits of count points from their state
+// (z = zx[i] + i * zy[i] after n[i] iterations) up to iter iterations, and
+// updates the state. Escaped orbits (|z| > 2) and orbits that already
+// reached iter are left untouched, so the result is the same as iterating
+// from 0 up to iter. Returns the number of skipped iterations too.
+typedef long (*resume_func)(const double * cx, const double * cy, double * zx, double * zy,
+        int * n, int count, int iter);
+
+// Kernels selected by kernel_init() (AVX-512, AVX2, SSE2 or scalar).
+// Every variant returns the same iteration counts as the scalar one.
+extern kernel_func mandelbrot_points;
+extern resume_func mandelbrot_resume;
+
+// Selects the widest kernel supported by the CPU (and those of the other
+// formulas, see escape.h).
+void kernel_init(void);
+// Name of the selected kernel.
+const char * kernel_name(void);
+
+// Normalized iteration count of the orbit of c = cx + i * cy, stopped at
+// z = zx + i * zy after n iterations: the orbit is continued a few
+// iterations past its escape, so that the count grows continuously with
+// the point instead of in bands. It stays close to n, and an orbit that
+// has not escaped (|z| <= 2) gives exactly n.
+float mandelbrot_smooth_count(double cx, double cy, int n, double zx, double zy);
+// Normalized iteration counts of count points, computed with the resumable
+// kernel (which keeps the point of escape). Returns the number of skipped
+// iterations.
+long mandelbrot_smooth(const double * cx, const double * cy, int count, int iter, float * out);
+
+// Scalar iteration of a single point.
+int mandelbrot_point(double x0, double y0, int iter);
+// Scalar iteration of a single point, resumed from z = *zx + i * *zy after
+// n iterations. Returns the new iteration count and updates z.
+int mandelbrot_resume_point(double x0, double y0, double * zx, double * zy, int n, int iter);
+
+#endif
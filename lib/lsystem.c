@@ -0,0 +1,75 @@
+#include <math.h>
+#include "lsystem.h"
+
+// Both curves replace a segment by the two sides of the right isosceles
+// triangle built on it, the first side being rotated by -45 degrees: the
+// first segment of level n is rotated by -45 * n degrees.
+static int start(int level)
+{
+    return -level;
+}
+
+// The segment k of the dragon turns left or right depending on the bit
+// above the lowest set bit of k.
+static int dragon_turn(unsigned long k)
+{
+    return ((k >> __builtin_ctzl(k)) & 3) == 1 ? 2 : -2;
+}
+
+// The heading of the segment k of the Levy C curve is -level + 2 * the
+// number of bits set in k, hence the turn.
+static int levy_turn(unsigned long k)
+{
+    return 2 - 2 * __builtin_ctzl(k);
+}
+
+const struct lsystem DRAGON = { start, dragon_turn };
+const struct lsystem LEVY = { start, levy_turn };
+
+void lsystem_generate(const struct lsystem * lsystem, double x, double y, double z, double t,
+        int level, lsystem_sink sink, void * data)
+{
+    struct fpoint chunk[LSYSTEM_CHUNK];
+    double step[8][2];
+
+    // Moves for the 8 headings: the segments are sqrt(2)^level times
+    // shorter than the one joining the ends.
+    double len = hypot(z - x, t - y) * pow(M_SQRT1_2, level);
+    double angle = atan2(t - y, z - x);
+    for (int d = 0; d < 8; d++)
+    {
+        step[d][0] = len * cos(angle + d * M_PI_4);
+        step[d][1] = len * sin(angle + d * M_PI_4);
+    }
+
+    unsigned long count = 1UL << level;
+    int heading = lsystem->start(level) & 7;
+    int n = 0;
+
+    chunk[n].x = x;
+    chunk[n].y = y;
+    n++;
+
+    for (unsigned long k = 0; k < count; k++)
+    {
+        if (k > 0)
+            heading = (heading + lsystem->turn(k)) & 7;
+        x += step[heading][0];
+        y += step[heading][1];
+
+        chunk[n].x = x;
+        chunk[n].y = y;
+        n++;
+
+        // Hands the chunk over, keeping its last vertex.
+        if (n == LSYSTEM_CHUNK)
+        {
+            sink(data, chunk, n);
+            chunk[0] = chunk[n - 1];
+            n = 1;
+        }
+    }
+
+    if (n > 1)
+        sink(data, chunk, n);
+}
@@ -0,0 +1,45 @@
+#ifndef LSYSTEM_H
+#define LSYSTEM_H
+
+// Iterative turtle for the curves whose segments all have the same length
+// and whose turns are multiples of 45 degrees (dragon, Levy C curve): the
+// heading of every segment follows from the index of the segment, so the
+// curve is generated step by step, in constant memory, with double
+// precision coordinates (no recursion, no integer midpoints).
+
+// Vertex of a curve (same layout as SDL_FPoint).
+struct fpoint
+{
+    float x;
+    float y;
+};
+
+// Number of vertices handed to the sink at once.
+#define LSYSTEM_CHUNK 4096
+
+// Receives the vertices of a curve, chunk by chunk. Consecutive chunks
+// share a vertex (the last one of a chunk is the first of the next one), so
+// that every chunk can be drawn as a polyline on its own.
+typedef void (*lsystem_sink)(void * data, const struct fpoint * points, int count);
+
+// Turn sequence of a curve, in eighths of a turn.
+struct lsystem
+{
+    // Heading of the first segment of the curve of a level, relative to
+    // the segment joining its ends.
+    int (*start)(int level);
+    // Turn between the segments k - 1 and k (k >= 1).
+    int (*turn)(unsigned long k);
+};
+
+// Heighway dragon (paper folding sequence).
+extern const struct lsystem DRAGON;
+// Levy C curve.
+extern const struct lsystem LEVY;
+
+// Generates the 2^level segments of a curve from (x, y) to (z, t), and
+// hands its 2^level + 1 vertices to the sink.
+void lsystem_generate(const struct lsystem * lsystem, double x, double y, double z, double t,
+        int level, lsystem_sink sink, void * data);
+
+#endif
@@ -0,0 +1,39 @@
+#include <stddef.h>
+#include "mailbox.h"
+
+void mailbox_init(struct mailbox * mailbox, void * a, void * b, void * c)
+{
+    mailbox->buffers[0] = a;
+    mailbox->buffers[1] = b;
+    mailbox->buffers[2] = c;
+    mailbox->slot = 0;
+    mailbox->writer = 1;
+    mailbox->reader = 2;
+}
+
+void * mailbox_back(struct mailbox * mailbox)
+{
+    return mailbox->buffers[mailbox->writer];
+}
+
+void mailbox_publish(struct mailbox * mailbox)
+{
+    // Release: the reader sees the content of the buffer with it.
+    int old = __atomic_exchange_n(&mailbox->slot, mailbox->writer | MAILBOX_FRESH, __ATOMIC_ACQ_REL);
+    mailbox->writer = old & ~MAILBOX_FRESH;
+}
+
+int mailbox_pending(const struct mailbox * mailbox)
+{
+    return (__atomic_load_n(&mailbox->slot, __ATOMIC_RELAXED) & MAILBOX_FRESH) != 0;
+}
+
+void * mailbox_take(struct mailbox * mailbox)
+{
+    if (!mailbox_pending(mailbox))
+        return NULL;
+
+    int old = __atomic_exchange_n(&mailbox->slot, mailbox->reader, __ATOMIC_ACQ_REL);
+    mailbox->reader = old & ~MAILBOX_FRESH;
+    return mailbox->buffers[mailbox->reader];
+}
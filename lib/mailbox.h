@@ -0,0 +1,36 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+// Lock-free single-slot mailbox from one thread to another, holding the
+// latest of the messages sent (triple buffering): the writer fills its
+// buffer and exchanges it with the slot, the reader exchanges its buffer
+// with the slot when it is fresh. Neither ever waits for the other, and a
+// buffer is only accessed by its owner.
+struct mailbox
+{
+    void * buffers[3];
+    // Index of the buffer in the slot, with MAILBOX_FRESH if it has been
+    // published since the reader last took it.
+    int slot;
+    // Indices of the buffers of the writer and of the reader.
+    int writer;
+    int reader;
+};
+
+#define MAILBOX_FRESH 4
+
+// Initializes a mailbox with three buffers.
+void mailbox_init(struct mailbox * mailbox, void * a, void * b, void * c);
+// Buffer of the writer, to fill before publishing it.
+void * mailbox_back(struct mailbox * mailbox);
+// Publishes the buffer of the writer (replacing the message in the slot if
+// it has not been taken), and gives the writer another buffer.
+void mailbox_publish(struct mailbox * mailbox);
+// Whether a message has been published since the last one taken (any
+// thread).
+int mailbox_pending(const struct mailbox * mailbox);
+// Takes the latest message (owned by the reader until the next call), or
+// returns NULL if there is none.
+void * mailbox_take(struct mailbox * mailbox);
+
+#endif
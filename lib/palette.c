@@ -0,0 +1,145 @@
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "palette.h"
+
+// Built-in palettes: the gradients of the static and of the dynamic viewer
+// (from the outside to the set), and two cyclic ones.
+static const struct
+{
+    const char * name;
+    int cyclic;
+    int count;
+    Uint32 stops[5];
+}
+BUILTINS[PALETTE_BUILTINS] =
+{
+    { "gray", 0, 2, { 0xffffff, 0x000000 } },
+    { "blue", 0, 2, { 0x5555ff, 0x000000 } },
+    { "fire", 1, 5, { 0x000000, 0x800000, 0xff4000, 0xffc000, 0xffffe0 } },
+    { "ocean", 1, 5, { 0x000764, 0x206bcb, 0xedffff, 0xffaa00, 0x000200 } },
+};
+
+// Reads the color stops of a gradient file.
+//
+// palette: Palette to fill.
+// path: Path of the file.
+static void load(struct palette * palette, const char * path)
+{
+    FILE * file = fopen(path, "r");
+    if (!file)
+        err(EXIT_FAILURE, "%s", path);
+
+    char line[256];
+    int number = 0;
+    palette->name = path;
+    palette->cyclic = 1;
+    palette->count = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        number++;
+        int r, g, b;
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#')
+            continue;
+        if (sscanf(line, "%d %d %d", &r, &g, &b) != 3
+                || r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255)
+            errx(EXIT_FAILURE, "%s:%d: Invalid color (expected R G B)", path, number);
+        if (palette->count == PALETTE_STOPS)
+            errx(EXIT_FAILURE, "%s: More than %d colors", path, PALETTE_STOPS);
+        palette->stops[palette->count++] = (Uint32) r << 16 | (Uint32) g << 8 | (Uint32) b;
+    }
+    fclose(file);
+
+    if (palette->count < 2)
+        errx(EXIT_FAILURE, "%s: A gradient needs at least 2 colors", path);
+}
+
+int palette_parse(struct palettes * palettes, int * first, int argc, char * argv[])
+{
+    int n = 1;
+
+    for (int i = 0; i < PALETTE_BUILTINS; i++)
+    {
+        struct palette * palette = &palettes->list[i];
+        palette->name = BUILTINS[i].name;
+        palette->cyclic = BUILTINS[i].cyclic;
+        palette->count = BUILTINS[i].count;
+        memcpy(palette->stops, BUILTINS[i].stops, BUILTINS[i].count * sizeof(Uint32));
+        palette->format = SDL_PIXELFORMAT_UNKNOWN;
+    }
+    palettes->count = PALETTE_BUILTINS;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--palette") == 0 && i + 1 < argc)
+        {
+            struct palette * palette = &palettes->list[PALETTE_BUILTINS];
+            load(palette, argv[++i]);
+            palette->format = SDL_PIXELFORMAT_UNKNOWN;
+            palettes->count = PALETTE_BUILTINS + 1;
+            *first = PALETTE_BUILTINS;
+        }
+        else
+            argv[n++] = argv[i];
+    }
+    argv[n] = NULL;
+
+    return n;
+}
+
+uint64_t palette_hash(const struct palette * palette)
+{
+    // 64-bit FNV-1a of the stops, then of the cyclic flag.
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < palette->count; i++)
+        for (int c = 0; c < 3; c++)
+            h = (h ^ (palette->stops[i] >> (8 * c) & 0xff)) * 0x100000001b3ULL;
+    return (h ^ (uint64_t) palette->cyclic) * 0x100000001b3ULL;
+}
+
+void palette_map(struct palette * palette, const SDL_PixelFormat * format)
+{
+    if (palette->format == format->format)
+        return;
+
+    // A cyclic gradient goes back to its first stop at the end of the table.
+    int spans = palette->cyclic ? palette->count : palette->count - 1;
+    for (int i = 0; i < PALETTE_SIZE; i++)
+    {
+        float t = (float) i * spans / (palette->cyclic ? PALETTE_SIZE : PALETTE_SIZE - 1);
+        int k = (int) t;
+        k = k < spans ? k : spans - 1;
+        float f = t - k;
+
+        Uint32 a = palette->stops[k];
+        Uint32 b = palette->stops[(k + 1) % palette->count];
+        Uint8 rgb[3];
+        for (int c = 0; c < 3; c++)
+        {
+            int ca = a >> (16 - 8 * c) & 0xff;
+            int cb = b >> (16 - 8 * c) & 0xff;
+            rgb[c] = (Uint8) (ca + (cb - ca) * f + 0.5f);
+        }
+        palette->lut[i] = SDL_MapRGB(format, rgb[0], rgb[1], rgb[2]);
+    }
+    palette->lut[PALETTE_SIZE] = SDL_MapRGB(format, 0, 0, 0);
+    palette->format = format->format;
+}
+
+void palette_apply(const struct palette * palette, const float * values, int count, int iter,
+        Uint32 * out)
+{
+    // Cyclic palettes wrap around the table, the others span [0, iter).
+    float scale = palette->cyclic ? (float) PALETTE_SIZE / PALETTE_PERIOD
+        : (float) (PALETTE_SIZE - 1) / iter;
+    int mask = palette->cyclic ? PALETTE_SIZE - 1 : -1;
+    float limit = (float) iter;
+
+    for (int i = 0; i < count; i++)
+    {
+        float v = values[i];
+        int k = (int) (v * scale) & mask;
+        out[i] = palette->lut[v < limit ? k : PALETTE_SIZE];
+    }
+}
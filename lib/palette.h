@@ -0,0 +1,71 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+// Palettes of the escape-time fractals: a gradient of evenly spaced color
+// stops, sampled into a lookup table in the pixel format of the frames.
+// Coloring is a separate pass over the normalized iteration counts of a
+// frame (see mandelbrot_smooth_count()), so another palette only recolors
+// the frame, without iterating any point.
+
+// Number of entries of the lookup table (a power of 2).
+#define PALETTE_SIZE 1024
+// Most color stops of a gradient.
+#define PALETTE_STOPS 256
+// Iterations covered by a period of a cyclic palette.
+#define PALETTE_PERIOD 64
+// Number of built-in palettes.
+#define PALETTE_BUILTINS 4
+
+struct palette
+{
+    const char * name;
+    // Color stops of the gradient (0xRRGGBB).
+    Uint32 stops[PALETTE_STOPS];
+    int count;
+    // Whether the gradient repeats every PALETTE_PERIOD iterations (the
+    // last stop going back to the first one), or spans the iteration range.
+    int cyclic;
+    // Lookup table, in the pixel format it was built for: entry
+    // PALETTE_SIZE is the color of the points of the set (black).
+    Uint32 lut[PALETTE_SIZE + 1];
+    Uint32 format;
+};
+
+// Palettes of a program: the built-in ones, then the one of the file given
+// by --palette.
+struct palettes
+{
+    struct palette list[PALETTE_BUILTINS + 1];
+    int count;
+};
+
+// Loads the built-in palettes, and the gradient file given by --palette
+// FILE, removed from the arguments. A gradient file has a color stop per
+// line, as three components from 0 to 255 followed by anything (the format
+// of the Fractint .map files); lines starting with '#' are comments. The
+// palette of a file is cyclic.
+// first is set to the index of the palette of the file, or left untouched.
+// Returns the number of remaining arguments.
+int palette_parse(struct palettes * palettes, int * first, int argc, char * argv[]);
+// Hash of the gradient of a palette (its stops and whether it is cyclic):
+// the palettes of a file are named after its path, whose contents can
+// change.
+uint64_t palette_hash(const struct palette * palette);
+// Builds the lookup table of a palette, if it was built for another format.
+void palette_map(struct palette * palette, const SDL_PixelFormat * format);
+// Colors count pixels from their normalized iteration counts: the counts
+// of iter or more are the points of the set. A branch-free loop over the
+// lookup table, which the compiler vectorizes.
+//
+// palette: Palette, mapped in the format of out.
+// values: Normalized iteration counts.
+// count: Number of pixels.
+// iter: Number of iterations of the frame.
+// out: Pixels.
+void palette_apply(const struct palette * palette, const float * values, int count, int iter,
+        Uint32 * out);
+
+#endif
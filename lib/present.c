@@ -0,0 +1,170 @@
+#include <err.h>
+#include <stdlib.h>
+#include "present.h"
+#include "tiles.h"
+
+void present_init(struct presenter * presenter, SDL_Renderer * renderer)
+{
+    presenter->renderer = renderer;
+    presenter->texture = NULL;
+    presenter->format = 0;
+    presenter->w = 0;
+    presenter->h = 0;
+}
+
+void present_quit(struct presenter * presenter)
+{
+    if (presenter->texture)
+        SDL_DestroyTexture(presenter->texture);
+    presenter->texture = NULL;
+}
+
+// Reallocates the texture if the size or the format of the frames changed.
+//
+// presenter: Presenter of the window.
+// format: Pixel format of the frames.
+// w: Width of the frames.
+// h: Height of the frames.
+static void reserve(struct presenter * presenter, Uint32 format, int w, int h)
+{
+    if (presenter->texture && presenter->format == format
+            && presenter->w == w && presenter->h == h)
+        return;
+
+    present_quit(presenter);
+    presenter->texture = SDL_CreateTexture(presenter->renderer, format,
+            SDL_TEXTUREACCESS_STREAMING, w, h);
+    if (presenter->texture == NULL)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    presenter->format = format;
+    presenter->w = w;
+    presenter->h = h;
+}
+
+void present_surface(struct presenter * presenter, SDL_Surface * surface, int w, int h)
+{
+    // Only the part covered by the surface can be shown.
+    w = w < surface->w ? w : surface->w;
+    h = h < surface->h ? h : surface->h;
+    if (w <= 0 || h <= 0)
+        return;
+
+    reserve(presenter, surface->format->format, w, h);
+
+    // Uploads the pixels into the existing texture
+    if (SDL_UpdateTexture(presenter->texture, NULL, surface->pixels, surface->pitch) != 0)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    SDL_Rect rect = { 0, 0, w, h };
+    SDL_RenderCopy(presenter->renderer, presenter->texture, NULL, &rect);
+
+    // Updates the display.
+    SDL_RenderPresent(presenter->renderer);
+}
+
+void draw_segments(SDL_Renderer * renderer, const struct segments * segments)
+{
+    for (size_t i = 0; i < segments->len; i++)
+    {
+        const struct segment * s = &segments->data[i];
+        SDL_RenderDrawLine(renderer, s->x1, s->y1, s->x2, s->y2);
+    }
+}
+
+void draw_polyline(SDL_Renderer * renderer, const struct points * points)
+{
+    // struct point has the layout of SDL_Point.
+    if (points->len > 1)
+        SDL_RenderDrawLines(renderer, (const SDL_Point *) points->data, (int) points->len);
+}
+
+void draw_chunk(void * data, const struct fpoint * points, int count)
+{
+    // struct fpoint has the layout of SDL_FPoint.
+    SDL_RenderDrawLinesF(data, (const SDL_FPoint *) points, count);
+}
+
+// Rows of the carpet to paint.
+struct carpet_rows
+{
+    SDL_Surface * surface;
+    const signed char * positions;
+    // Masks of the untouched columns, and colors of the rows in the middle
+    // of their parents.
+    const Uint32 * keep;
+    const Uint32 * middle;
+    Uint32 black;
+    int x;
+    int y;
+    int w;
+};
+
+// Paints rows of the carpet (tile function, the rows being laid out
+// vertically): every pixel is a select between its old value and the color
+// of its row, which vectorizes.
+static void paint_rows(void * data, int x, int y, int w, int h)
+{
+    const struct carpet_rows * c = data;
+    (void) x;
+    (void) w;
+
+    for (int j = y; j < y + h; j++)
+    {
+        int position = c->positions[j];
+        if (position == CARPET_UNTOUCHED)
+            continue;
+
+        Uint32 * row = (Uint32 *) ((Uint8 *) c->surface->pixels + (c->y + j) * c->surface->pitch) + c->x;
+        if (position == 1)
+            for (int i = 0; i < c->w; i++)
+                row[i] = (row[i] & c->keep[i]) | (c->middle[i] & ~c->keep[i]);
+        else
+            for (int i = 0; i < c->w; i++)
+                row[i] = (row[i] & c->keep[i]) | (c->black & ~c->keep[i]);
+    }
+}
+
+void paint_carpet(SDL_Surface * surface, int x, int y, int n, int limit)
+{
+    // Part of the carpet inside the surface.
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + n < surface->w ? x + n : surface->w;
+    int y1 = y + n < surface->h ? y + n : surface->h;
+    if (n <= 0 || x0 >= x1 || y0 >= y1)
+        return;
+
+    signed char * positions = malloc(n);
+    Uint32 * masks = malloc(2 * (size_t) (x1 - x0) * sizeof(Uint32));
+    if (!positions || !masks)
+        errx(EXIT_FAILURE, "Unable to allocate the carpet");
+
+    // Both axes have the same decomposition.
+    carpet_axis(positions, n, limit);
+
+    struct carpet_rows c;
+    c.surface = surface;
+    c.positions = positions + (y0 - y);
+    c.keep = masks;
+    c.middle = masks + (x1 - x0);
+    c.black = SDL_MapRGB(surface->format, 0, 0, 0);
+    c.x = x0;
+    c.y = y0;
+    c.w = x1 - x0;
+
+    Uint32 white = SDL_MapRGB(surface->format, 255, 255, 255);
+    for (int i = 0; i < c.w; i++)
+    {
+        int position = positions[x0 - x + i];
+        masks[i] = position == CARPET_UNTOUCHED ? 0xffffffff : 0;
+        masks[c.w + i] = position == 1 ? white : c.black;
+    }
+
+    SDL_LockSurface(surface);
+    render_tiles(1, y1 - y0, paint_rows, &c);
+    SDL_UnlockSurface(surface);
+
+    free(masks);
+    free(positions);
+}
@@ -0,0 +1,37 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <SDL2/SDL.h>
+#include "fractals.h"
+#include "lsystem.h"
+
+// Presentation layer of a window: owns one streaming texture, reallocated
+// only when the size of the frames changes.
+struct presenter
+{
+    SDL_Renderer * renderer;
+    SDL_Texture * texture;
+    Uint32 format;
+    int w;
+    int h;
+};
+
+// Initializes a presenter (the texture is created by the first frame).
+void present_init(struct presenter * presenter, SDL_Renderer * renderer);
+// Destroys the texture of a presenter.
+void present_quit(struct presenter * presenter);
+// Uploads the w x h top left part of a surface and displays it.
+void present_surface(struct presenter * presenter, SDL_Surface * surface, int w, int h);
+
+// Draws a list of segments with the current color of the renderer.
+void draw_segments(SDL_Renderer * renderer, const struct segments * segments);
+// Draws a list of vertices as a single polyline (one renderer call).
+void draw_polyline(SDL_Renderer * renderer, const struct points * points);
+// Sink of lsystem_generate() drawing every chunk of vertices as a
+// polyline (data is the renderer).
+void draw_chunk(void * data, const struct fpoint * points, int count);
+// Paints the Sierpinski carpet of side n at (x, y) into a 32-bit surface
+// (see carpet_axis()), by bands of rows on the tile pool.
+void paint_carpet(SDL_Surface * surface, int x, int y, int n, int limit);
+
+#endif
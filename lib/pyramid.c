@@ -0,0 +1,269 @@
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "image.h"
+#include "pyramid.h"
+
+// Longest path of the pyramid.
+#define PATH 4096
+
+// 64-bit FNV-1a hash of bytes.
+static uint64_t hash(uint64_t h, const void * data, size_t len)
+{
+    const unsigned char * p = data;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+#define HASH_INIT 0xcbf29ce484222325ULL
+
+// Creates a directory, if it does not exist.
+static void directory(const char * path)
+{
+    if (mkdir(path, 0755) != 0 && errno != EEXIST)
+        err(EXIT_FAILURE, "%s", path);
+}
+
+// Formats a path of the pyramid.
+static void path(char * out, const char * format, ...) __attribute__((format(printf, 2, 3)));
+static void path(char * out, const char * format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(out, PATH, format, args);
+    va_end(args);
+
+    if (len < 0 || len >= PATH)
+        errx(EXIT_FAILURE, "Path too long: %s", out);
+}
+
+// Tile waiting for the writer: its pixels, in the format of the surface it
+// was rendered into.
+struct pending
+{
+    int z;
+    int x;
+    int y;
+    char key[PYRAMID_KEY];
+    const SDL_PixelFormat * format;
+    Uint32 pixels[PYRAMID_TILE * PYRAMID_TILE];
+};
+
+// Writer thread: a queue of tiles (count tiles from head), and the buffers
+// of the writer.
+struct pyramid_writer
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    // Signaled when a tile is queued or the writer must stop.
+    pthread_cond_t wake;
+    // Signaled when a tile is stored.
+    pthread_cond_t space;
+    struct pending queue[PYRAMID_QUEUE];
+    int head;
+    int count;
+    int stopping;
+
+    unsigned char rgb[PYRAMID_TILE * PYRAMID_TILE * 3];
+    struct png_writer png;
+};
+
+// Links the file of a tile to an object of the store.
+static void link_tile(const struct pyramid * pyramid, int z, int x, int y, uint64_t object)
+{
+    char target[PATH], tile[PATH];
+
+    path(target, "%s/.cache/objects/%016llx.png", pyramid->dir, (unsigned long long) object);
+    path(tile, "%s/%d", pyramid->dir, z);
+    directory(tile);
+    path(tile, "%s/%d/%d", pyramid->dir, z, x);
+    directory(tile);
+    path(tile, "%s/%d/%d/%d.png", pyramid->dir, z, x, y);
+
+    if (unlink(tile) != 0 && errno != ENOENT)
+        err(EXIT_FAILURE, "%s", tile);
+    if (link(target, tile) != 0)
+        err(EXIT_FAILURE, "%s", tile);
+}
+
+// Stores a tile (writer thread).
+static void store(struct pyramid * pyramid, const struct pending * tile)
+{
+    struct pyramid_writer * writer = pyramid->writer;
+    unsigned char * rgb = writer->rgb;
+    size_t size = sizeof(writer->rgb);
+    char name[PATH], temporary[PATH];
+
+    // The tile is addressed by the hash of its pixels.
+    for (int i = 0; i < PYRAMID_TILE * PYRAMID_TILE; i++)
+        SDL_GetRGB(tile->pixels[i], tile->format, &rgb[3 * i], &rgb[3 * i + 1], &rgb[3 * i + 2]);
+    uint64_t object = hash(HASH_INIT, rgb, size);
+
+    // The objects and the keys are written under a temporary name, then
+    // renamed, so a killed run never leaves a truncated one.
+    path(name, "%s/.cache/objects/%016llx.png", pyramid->dir, (unsigned long long) object);
+    if (access(name, F_OK) != 0)
+    {
+        path(temporary, "%s.tmp", name);
+        FILE * file = fopen(temporary, "wb");
+        if (!file)
+            err(EXIT_FAILURE, "%s", temporary);
+        png_begin(&writer->png, file, PYRAMID_TILE, PYRAMID_TILE);
+        for (int j = 0; j < PYRAMID_TILE; j++)
+            png_write_row(&writer->png, rgb + j * PYRAMID_TILE * 3);
+        png_end(&writer->png);
+        if (fclose(file) != 0 || rename(temporary, name) != 0)
+            err(EXIT_FAILURE, "%s", name);
+    }
+
+    path(name, "%s/.cache/keys/%016llx", pyramid->dir,
+            (unsigned long long) hash(HASH_INIT, tile->key, strlen(tile->key)));
+    path(temporary, "%s.tmp", name);
+    FILE * file = fopen(temporary, "w");
+    if (!file)
+        err(EXIT_FAILURE, "%s", temporary);
+    fprintf(file, "%016llx %s\n", (unsigned long long) object, tile->key);
+    if (fclose(file) != 0 || rename(temporary, name) != 0)
+        err(EXIT_FAILURE, "%s", name);
+
+    link_tile(pyramid, tile->z, tile->x, tile->y, object);
+}
+
+// Stores the queued tiles until the pyramid is closed.
+static void * writer_main(void * data)
+{
+    struct pyramid * pyramid = data;
+    struct pyramid_writer * writer = pyramid->writer;
+
+    pthread_mutex_lock(&writer->lock);
+    while (1)
+    {
+        while (writer->count == 0 && !writer->stopping)
+            pthread_cond_wait(&writer->wake, &writer->lock);
+        if (writer->count == 0)
+            break;
+
+        // The producer does not touch the queued tiles.
+        pthread_mutex_unlock(&writer->lock);
+        store(pyramid, &writer->queue[writer->head]);
+        pthread_mutex_lock(&writer->lock);
+
+        writer->head = (writer->head + 1) % PYRAMID_QUEUE;
+        writer->count--;
+        pyramid->rendered++;
+        pthread_cond_signal(&writer->space);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+void pyramid_open(struct pyramid * pyramid, const char * dir)
+{
+    char name[PATH];
+
+    pyramid->dir = dir;
+    pyramid->cached = 0;
+    pyramid->rendered = 0;
+
+    directory(dir);
+    path(name, "%s/.cache", dir);
+    directory(name);
+    path(name, "%s/.cache/keys", dir);
+    directory(name);
+    path(name, "%s/.cache/objects", dir);
+    directory(name);
+
+    struct pyramid_writer * writer = malloc(sizeof(struct pyramid_writer));
+    if (!writer)
+        errx(EXIT_FAILURE, "Unable to allocate the writer of the pyramid");
+    writer->head = 0;
+    writer->count = 0;
+    writer->stopping = 0;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wake, NULL);
+    pthread_cond_init(&writer->space, NULL);
+    pyramid->writer = writer;
+
+    if (pthread_create(&writer->thread, NULL, writer_main, pyramid))
+        errx(EXIT_FAILURE, "Unable to start the writer of the pyramid");
+}
+
+void pyramid_close(struct pyramid * pyramid)
+{
+    struct pyramid_writer * writer = pyramid->writer;
+
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = 1;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_cond_destroy(&writer->space);
+    pthread_cond_destroy(&writer->wake);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
+
+int pyramid_cached(struct pyramid * pyramid, int z, int x, int y, const char * key)
+{
+    char name[PATH];
+    char recorded[PATH] = "";
+    unsigned long long object = 0;
+
+    path(name, "%s/.cache/keys/%016llx", pyramid->dir,
+            (unsigned long long) hash(HASH_INIT, key, strlen(key)));
+    FILE * file = fopen(name, "r");
+    if (!file)
+        return 0;
+    int found = fscanf(file, "%llx ", &object) == 1 && fgets(recorded, sizeof(recorded), file);
+    fclose(file);
+    recorded[strcspn(recorded, "\n")] = '\0';
+    found = found && strcmp(recorded, key) == 0;
+
+    // The object may have been removed from the store.
+    path(name, "%s/.cache/objects/%016llx.png", pyramid->dir, object);
+    if (!found || access(name, F_OK) != 0)
+        return 0;
+
+    link_tile(pyramid, z, x, y, object);
+    pyramid->cached++;
+    return 1;
+}
+
+void pyramid_write(struct pyramid * pyramid, int z, int x, int y, const char * key,
+        SDL_Surface * surface, int sx, int sy)
+{
+    struct pyramid_writer * writer = pyramid->writer;
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count == PYRAMID_QUEUE)
+        pthread_cond_wait(&writer->space, &writer->lock);
+    struct pending * tile = &writer->queue[(writer->head + writer->count) % PYRAMID_QUEUE];
+    pthread_mutex_unlock(&writer->lock);
+
+    // The free slots are only touched by the producer.
+    tile->z = z;
+    tile->x = x;
+    tile->y = y;
+    strcpy(tile->key, key);
+    tile->format = surface->format;
+    SDL_LockSurface(surface);
+    for (int j = 0; j < PYRAMID_TILE; j++)
+        memcpy(tile->pixels + j * PYRAMID_TILE,
+                (const Uint32 *) ((const Uint8 *) surface->pixels + (sy + j) * surface->pitch) + sx,
+                PYRAMID_TILE * sizeof(Uint32));
+    SDL_UnlockSurface(surface);
+
+    pthread_mutex_lock(&writer->lock);
+    writer->count++;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+}
@@ -0,0 +1,50 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <SDL2/SDL.h>
+
+// Side of the tiles of a pyramid, in pixels.
+#define PYRAMID_TILE 256
+// Size of the parameters of a tile (with the final null character).
+#define PYRAMID_KEY 512
+// Tiles waiting for the writer thread.
+#define PYRAMID_QUEUE 4
+
+// Tile pyramid for the slippy-map viewers: the tile (x, y) of level z is
+// the file DIR/z/x/y.png (XYZ layout), a hard link to its content in a
+// content-addressed store, DIR/.cache/objects/HASH.png, so the identical
+// tiles (every tile inside a fractal, for instance) are stored once. The
+// parameters of every rendered tile are recorded (DIR/.cache/keys/HASH,
+// holding the hash of its content), so that a pyramid generated again only
+// renders the tiles it does not have yet.
+//
+// The tiles are stored by a writer thread (converted, hashed, encoded and
+// written), while the next ones are rendered.
+struct pyramid
+{
+    const char * dir;
+    // Tiles linked from the cache and rendered (complete once closed).
+    long cached;
+    long rendered;
+
+    struct pyramid_writer * writer;
+};
+
+// Creates the directories of a pyramid and starts its writer.
+void pyramid_open(struct pyramid * pyramid, const char * dir);
+// Waits for the tiles being stored and stops the writer.
+void pyramid_close(struct pyramid * pyramid);
+// Links a tile to the content of the tile rendered with the same parameters
+// by a previous run, if there is one.
+// key: Parameters of the tile (everything its pixels depend on, shorter
+// than PYRAMID_KEY).
+// Returns whether the tile was in the cache.
+int pyramid_cached(struct pyramid * pyramid, int z, int x, int y, const char * key);
+// Stores a tile rendered into a surface (32 bits per pixel), from the
+// pixel (sx, sy) of the surface, and records its parameters. The pixels are
+// copied to the queue of the writer (waiting for it when it is full), so
+// the surface can be drawn on again on return.
+void pyramid_write(struct pyramid * pyramid, int z, int x, int y, const char * key,
+        SDL_Surface * surface, int sx, int sy);
+
+#endif
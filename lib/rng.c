@@ -0,0 +1,42 @@
+#include <err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rng.h"
+
+// SplitMix64 finalizer: a bijective mix of the 64 bits of z.
+static uint64_t mix(uint64_t z)
+{
+    z += 0x9e3779b97f4a7c15u;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+uint64_t rng_at(uint64_t seed, uint64_t depth, uint64_t index)
+{
+    return mix(mix(mix(seed) ^ depth) ^ index);
+}
+
+int rng_parse(uint64_t * seed, int argc, char * argv[])
+{
+    int n = 1;
+
+    *seed = (uint64_t) time(NULL);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            char * end;
+            *seed = strtoull(argv[++i], &end, 0);
+            if (*argv[i] == '\0' || *end != '\0')
+                errx(EXIT_FAILURE, "Invalid seed: %s", argv[i]);
+        }
+        else
+            argv[n++] = argv[i];
+    }
+    argv[n] = NULL;
+
+    return n;
+}
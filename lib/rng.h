@@ -0,0 +1,17 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Counter-based random numbers: the number drawn for an element is a hash
+// of (seed, depth, index), so any element can be computed on its own, in
+// any order and on any thread, and the same seed always gives the same
+// fractal.
+uint64_t rng_at(uint64_t seed, uint64_t depth, uint64_t index);
+
+// Seed given by --seed N, removed from the arguments, or a seed taken from
+// the clock when there is none.
+// Returns the number of remaining arguments.
+int rng_parse(uint64_t * seed, int argc, char * argv[]);
+
+#endif
@@ -0,0 +1,326 @@
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include "image.h"
+#include "rng.h"
+#include "terrain.h"
+#include "tiles.h"
+
+// Part of a heightmap held in memory: the points (x0 + i * scale,
+// y0 + j * scale) of the heightmap, for 0 <= i < w and 0 <= j < h, row by
+// row. Its borders are on multiples of the sides of the squares refined in
+// it.
+struct window
+{
+    float * data;
+    int x0;
+    int y0;
+    int w;
+    int h;
+    int scale;
+    int size;
+    uint64_t seed;
+};
+
+// Diamond or square step of the squares of a side, over some rows of a
+// window (in points of the window).
+struct pass
+{
+    const struct window * win;
+    int side;
+    int half;
+    float amplitude;
+    // Row k of the pass is the row first + k * step of the window.
+    int first;
+    int step;
+    // Columns of the pass (the first one is that of the first center for
+    // the diamond step).
+    int x0;
+    int x1;
+};
+
+int terrain_valid_size(int size)
+{
+    // Up to 2^24 + 1, so that the regions of refine() do not overflow.
+    for (int n = 1; n <= 24; n++)
+        if (size == (1 << n) + 1)
+            return 1;
+
+    return 0;
+}
+
+// Random displacement of a point of a window, within [-amplitude, amplitude].
+//
+// win: Window of the point.
+// amplitude: Largest displacement.
+// i: Column of the point in the window.
+// j: Row of the point in the window.
+static float displacement(const struct window * win, float amplitude, int i, int j)
+{
+    uint64_t x = (uint64_t) win->x0 + (uint64_t) i * win->scale;
+    uint64_t y = (uint64_t) win->y0 + (uint64_t) j * win->scale;
+
+    // 24 random bits, mapped exactly to [-1, 1).
+    float u = (float) (rng_at(win->seed, y, x) >> 40) * 0x1p-23f - 1.0f;
+    return amplitude * u;
+}
+
+// Sets the centers of the squares (tile function, the rows of the pass
+// being laid out vertically).
+static void diamond(void * data, int x, int y, int w, int h)
+{
+    const struct pass * p = data;
+    const struct window * win = p->win;
+    (void) x;
+    (void) w;
+
+    for (int k = y; k < y + h; k++)
+    {
+        int j = p->first + k * p->step;
+        const float * up = win->data + (size_t) (j - p->half) * win->w;
+        const float * down = win->data + (size_t) (j + p->half) * win->w;
+        float * row = win->data + (size_t) j * win->w;
+
+        for (int i = p->x0; i <= p->x1; i += p->side)
+        {
+            float sum = up[i - p->half] + up[i + p->half] + down[i - p->half] + down[i + p->half];
+            row[i] = sum / 4.0f + displacement(win, p->amplitude, i, j);
+        }
+    }
+}
+
+// Sets the middles of the edges of the squares (tile function, the rows of
+// the pass being laid out vertically). The middles on the borders of the
+// window only have three neighbours.
+static void square(void * data, int x, int y, int w, int h)
+{
+    const struct pass * p = data;
+    const struct window * win = p->win;
+    (void) x;
+    (void) w;
+
+    for (int k = y; k < y + h; k++)
+    {
+        int j = p->first + k * p->step;
+        float * row = win->data + (size_t) j * win->w;
+        const float * up = j - p->half >= 0 ? row - (size_t) p->half * win->w : NULL;
+        const float * down = j + p->half < win->h ? row + (size_t) p->half * win->w : NULL;
+
+        // The middles of the horizontal edges are between the corners, those
+        // of the vertical edges below them.
+        int offset = j % p->side == 0 ? p->half : 0;
+        int first = p->x0 + ((offset - p->x0) % p->side + p->side) % p->side;
+
+        for (int i = first; i <= p->x1; i += p->side)
+        {
+            float sum = 0;
+            int n = 0;
+            if (i - p->half >= 0)
+                sum += row[i - p->half], n++;
+            if (i + p->half < win->w)
+                sum += row[i + p->half], n++;
+            if (up)
+                sum += up[i], n++;
+            if (down)
+                sum += down[i], n++;
+
+            row[i] = sum / (float) n + displacement(win, p->amplitude, i, j);
+        }
+    }
+}
+
+// Runs the diamond or the square step of the squares of a side over the
+// points of a window within a region, on the tile pool.
+//
+// win: Window to refine.
+// side: Side of the squares, in points of the heightmap.
+// func: diamond() or square().
+// x0, y0, x1, y1: Region, in points of the heightmap (inclusive).
+static void step(const struct window * win, int side, tile_func func, int x0, int y0, int x1, int y1)
+{
+    // Region in points of the window.
+    int s = win->scale;
+    int lx0 = x0 <= win->x0 ? 0 : (x0 - win->x0 + s - 1) / s;
+    int ly0 = y0 <= win->y0 ? 0 : (y0 - win->y0 + s - 1) / s;
+    int lx1 = (x1 - win->x0) / s >= win->w ? win->w - 1 : (x1 - win->x0) / s;
+    int ly1 = (y1 - win->y0) / s >= win->h ? win->h - 1 : (y1 - win->y0) / s;
+
+    struct pass p;
+    p.win = win;
+    p.side = side / s;
+    p.half = p.side / 2;
+    p.amplitude = (float) side / (float) (win->size - 1);
+    p.x1 = lx1;
+
+    // The diamond step goes through the centers, the square step through
+    // every row of middles.
+    int offset = func == diamond ? p.half : 0;
+    p.step = func == diamond ? p.side : p.half;
+    p.first = ly0 + ((offset - ly0) % p.step + p.step) % p.step;
+    p.x0 = func == diamond ? lx0 + ((p.half - lx0) % p.side + p.side) % p.side : lx0;
+
+    if (p.first <= ly1 && p.x0 <= lx1)
+        render_tiles(1, (ly1 - p.first) / p.step + 1, func, &p);
+}
+
+// Runs the levels of the squares of sides from down to to over a window, on
+// the points needed to refine a region exactly: the last levels read up to
+// side - 2 points around it, so a level only refines these points (and the
+// centers their square step reads).
+//
+// win: Window to refine.
+// from: Side of the largest squares, in points of the heightmap.
+// to: Side of the smallest squares.
+// x0, y0, x1, y1: Region, in points of the heightmap (inclusive).
+static void refine(const struct window * win, int from, int to, int x0, int y0, int x1, int y1)
+{
+    for (int side = from; side >= to; side /= 2)
+    {
+        int r = side - 2;
+        int d = r + side / 2;
+        step(win, side, diamond, x0 - d, y0 - d, x1 + d, y1 + d);
+        step(win, side, square, x0 - r, y0 - r, x1 + r, y1 + r);
+    }
+}
+
+// Sets the random heights of the corners of a window holding the whole
+// heightmap.
+static void corners(const struct window * win)
+{
+    size_t last = (size_t) (win->h - 1) * win->w;
+    win->data[0] = displacement(win, 1.0f, 0, 0);
+    win->data[win->w - 1] = displacement(win, 1.0f, win->w - 1, 0);
+    win->data[last] = displacement(win, 1.0f, 0, win->h - 1);
+    win->data[last + win->w - 1] = displacement(win, 1.0f, win->w - 1, win->h - 1);
+}
+
+void terrain_generate(float * grid, int size, uint64_t seed)
+{
+    struct window win = { grid, 0, 0, size, size, 1, size, seed };
+    corners(&win);
+    refine(&win, size - 1, 2, 0, 0, size - 1, size - 1);
+}
+
+uint16_t terrain_quantize(float height)
+{
+    float v = (height + TERRAIN_BOUND) * (65535.0f / (2 * TERRAIN_BOUND)) + 0.5f;
+    return v <= 0 ? 0 : v >= 65535 ? 65535 : (uint16_t) v;
+}
+
+// Writes heights as 16-bit samples.
+//
+// file: Output file.
+// heights: Heights to write.
+// count: Number of heights.
+// pgm: Whether the samples are big endian (PGM) or little endian (raw).
+// samples: Buffer of 2 * count bytes.
+static void write_samples(FILE * file, const float * heights, int count, int pgm, unsigned char * samples)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint16_t v = terrain_quantize(heights[i]);
+        samples[2 * i + !pgm] = v >> 8;
+        samples[2 * i + pgm] = v & 0xff;
+    }
+
+    if (fwrite(samples, 2, count, file) != (size_t) count)
+        err(EXIT_FAILURE, "Unable to write the heightmap");
+}
+
+// Generates the heightmap in memory and writes it row by row.
+static void export_grid(FILE * file, int size, uint64_t seed, int pgm)
+{
+    float * grid = malloc((size_t) size * size * sizeof(float));
+    unsigned char * samples = malloc((size_t) size * 2);
+    if (!grid || !samples)
+        errx(EXIT_FAILURE, "Unable to allocate a %dx%d heightmap (try --stream)", size, size);
+
+    terrain_generate(grid, size, seed);
+    for (int y = 0; y < size; y++)
+        write_samples(file, grid + (size_t) y * size, size, pgm, samples);
+
+    free(samples);
+    free(grid);
+}
+
+// Generates the heightmap tile by tile, and writes every row of a tile at
+// its place in the file.
+static void export_tiles(FILE * file, int size, uint64_t seed, int pgm)
+{
+    off_t header = ftello(file);
+    int tile = size - 1 < TERRAIN_TILE ? size - 1 : TERRAIN_TILE;
+    int n = (size - 1) / tile;
+
+    // The corners of the tiles, generated by the levels of the squares
+    // larger than the tiles.
+    float * coarse = malloc((size_t) (n + 1) * (n + 1) * sizeof(float));
+    struct window cw = { coarse, 0, 0, n + 1, n + 1, tile, size, seed };
+
+    // A tile is refined from the corners of the tiles up to 2 tiles around
+    // it, which are all the points its levels read.
+    float * fine = calloc((size_t) (5 * tile + 1) * (5 * tile + 1), sizeof(float));
+    unsigned char * samples = malloc((size_t) (tile + 1) * 2);
+    if (!coarse || !fine || !samples)
+        errx(EXIT_FAILURE, "Unable to allocate the tiles of the heightmap");
+
+    corners(&cw);
+    refine(&cw, size - 1, 2 * tile, 0, 0, size - 1, size - 1);
+
+    for (int ty = 0; ty < n; ty++)
+        for (int tx = 0; tx < n; tx++)
+        {
+            int gx = tx * tile;
+            int gy = ty * tile;
+
+            struct window win = { fine, 0, 0, 0, 0, 1, size, seed };
+            win.x0 = gx - 2 * tile < 0 ? 0 : gx - 2 * tile;
+            win.y0 = gy - 2 * tile < 0 ? 0 : gy - 2 * tile;
+            win.w = (gx + 3 * tile > size - 1 ? size - 1 : gx + 3 * tile) - win.x0 + 1;
+            win.h = (gy + 3 * tile > size - 1 ? size - 1 : gy + 3 * tile) - win.y0 + 1;
+
+            for (int j = 0; j < win.h; j += tile)
+                for (int i = 0; i < win.w; i += tile)
+                    fine[(size_t) j * win.w + i] =
+                        coarse[(size_t) ((win.y0 + j) / tile) * (n + 1) + (win.x0 + i) / tile];
+
+            refine(&win, tile, 2, gx, gy, gx + tile, gy + tile);
+
+            // The tiles share their borders: the last row and column of a
+            // tile are only written by the tiles of the end of the heightmap.
+            int w = tile + (tx == n - 1);
+            int h = tile + (ty == n - 1);
+            for (int y = gy; y < gy + h; y++)
+            {
+                if (fseeko(file, header + ((off_t) y * size + gx) * 2, SEEK_SET) != 0)
+                    err(EXIT_FAILURE, "Unable to write the heightmap");
+                write_samples(file, fine + (size_t) (y - win.y0) * win.w + (gx - win.x0), w, pgm, samples);
+            }
+        }
+
+    free(samples);
+    free(fine);
+    free(coarse);
+}
+
+void terrain_export(const char * path, int size, uint64_t seed, int streamed)
+{
+    if (!terrain_valid_size(size))
+        errx(EXIT_FAILURE, "Invalid size of heightmap: %d (expected 2^n + 1)", size);
+
+    FILE * file = fopen(path, "wb");
+    if (!file)
+        err(EXIT_FAILURE, "%s", path);
+
+    int pgm = has_extension(path, ".pgm");
+    if (pgm)
+        fprintf(file, "P5\n%d %d\n65535\n", size, size);
+
+    if (streamed)
+        export_tiles(file, size, seed, pgm);
+    else
+        export_grid(file, size, seed, pgm);
+
+    if (fclose(file) != 0)
+        err(EXIT_FAILURE, "%s", path);
+}
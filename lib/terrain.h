@@ -0,0 +1,45 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <stdint.h>
+
+// Heightmaps generated by diamond-square: the midpoint displacement of the
+// mountain (see fractals.h) applied to a square grid of side 2^n + 1.
+// The corners get a random height in [-1, 1], then every square of side s
+// displaces its center (diamond step), then the middles of its edges
+// (square step), by up to s / (size - 1). The heights thus stay within
+// [-TERRAIN_BOUND, TERRAIN_BOUND].
+// As for the mountain, the displacement of a point only depends on the seed
+// and on its position, so the heightmap does not depend on the way it is
+// split between the threads, nor on the tiles of the streaming mode.
+#define TERRAIN_BOUND 3.0f
+
+// Side (in points) of the tiles of the streaming mode.
+#define TERRAIN_TILE 512
+
+// Whether size is a valid side of a heightmap (2^n + 1, with n >= 1).
+int terrain_valid_size(int size);
+// Generates a heightmap in memory, its passes being split by rows on the
+// tile pool (see tiles.h).
+//
+// grid: Heights of the heightmap (size * size floats, row by row).
+// size: Side of the heightmap (2^n + 1).
+// seed: Seed of the random displacements.
+void terrain_generate(float * grid, int size, uint64_t seed);
+// Maps a height to a 16-bit sample (-TERRAIN_BOUND to 0, TERRAIN_BOUND to
+// 65535).
+uint16_t terrain_quantize(float height);
+// Writes a heightmap to a file: a 16-bit binary PGM (.pgm) or raw 16-bit
+// little endian samples (.raw).
+// The heightmap is generated in memory, unless it is streamed: it is then
+// generated TERRAIN_TILE x TERRAIN_TILE tile by tile, from a grid of the
+// corners of the tiles, so only these two grids are held in memory. Both
+// modes write the same file.
+//
+// path: Path of the file.
+// size: Side of the heightmap (2^n + 1).
+// seed: Seed of the random displacements.
+// streamed: Whether the heightmap is generated tile by tile.
+void terrain_export(const char * path, int size, uint64_t seed, int streamed);
+
+#endif
@@ -0,0 +1,205 @@
+#include <err.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "tiles.h"
+
+// Tiles owned by a worker: the owner pops from the head, thieves steal
+// from the tail.
+struct range
+{
+    pthread_mutex_t lock;
+    int head;
+    int tail;
+};
+
+// Current frame, shared by all the workers.
+struct job
+{
+    tile_func func;
+    void * data;
+    int w;
+    int h;
+    int cols;
+};
+
+static int nworkers;
+static struct range * ranges;
+static pthread_t * threads;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;
+static struct job current;
+static unsigned long generation;
+static int busy;
+static int stopping;
+
+// Takes the next tile of a worker's own range.
+// Returns -1 if the range is empty.
+static int pop(int self)
+{
+    struct range * r = &ranges[self];
+    int tile = -1;
+
+    pthread_mutex_lock(&r->lock);
+    if (r->head < r->tail)
+        tile = r->head++;
+    pthread_mutex_unlock(&r->lock);
+
+    return tile;
+}
+
+// Steals half of the remaining tiles of another worker.
+// Returns the first stolen tile (the others go to the thief's range),
+// or -1 if every other range is empty.
+static int steal(int self)
+{
+    for (int i = 1; i < nworkers; i++)
+    {
+        struct range * victim = &ranges[(self + i) % nworkers];
+        int head, tail;
+
+        pthread_mutex_lock(&victim->lock);
+        tail = victim->tail;
+        head = tail - (victim->tail - victim->head + 1) / 2;
+        victim->tail = head;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (head < tail)
+        {
+            struct range * r = &ranges[self];
+            pthread_mutex_lock(&r->lock);
+            r->head = head + 1;
+            r->tail = tail;
+            pthread_mutex_unlock(&r->lock);
+            return head;
+        }
+    }
+
+    return -1;
+}
+
+// Renders tiles until there is nothing left to pop or steal.
+static void work(int self, const struct job * job)
+{
+    int tile;
+
+    while ((tile = pop(self)) >= 0 || (tile = steal(self)) >= 0)
+    {
+        int x = (tile % job->cols) * TILE_SIZE;
+        int y = (tile / job->cols) * TILE_SIZE;
+        int w = job->w - x < TILE_SIZE ? job->w - x : TILE_SIZE;
+        int h = job->h - y < TILE_SIZE ? job->h - y : TILE_SIZE;
+        job->func(job->data, x, y, w, h);
+    }
+}
+
+// Main function of the helper threads.
+static void * worker(void * arg)
+{
+    int self = (int) (long) arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool_lock);
+    while (1)
+    {
+        while (generation == seen && !stopping)
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        if (stopping)
+            break;
+
+        seen = generation;
+        struct job job = current;
+        busy++;
+        pthread_mutex_unlock(&pool_lock);
+
+        work(self, &job);
+
+        pthread_mutex_lock(&pool_lock);
+        if (--busy == 0)
+            pthread_cond_signal(&pool_idle);
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    return NULL;
+}
+
+void tiles_init(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    nworkers = n < 1 ? 1 : (int) n;
+
+    ranges = calloc(nworkers, sizeof(struct range));
+    threads = calloc(nworkers, sizeof(pthread_t));
+    if (!ranges || !threads)
+        errx(EXIT_FAILURE, "Unable to allocate the thread pool");
+
+    for (int i = 0; i < nworkers; i++)
+        pthread_mutex_init(&ranges[i].lock, NULL);
+
+    // Worker 0 is the thread calling render_tiles().
+    for (int i = 1; i < nworkers; i++)
+        if (pthread_create(&threads[i], NULL, worker, (void *) (long) i))
+            errx(EXIT_FAILURE, "Unable to start a render thread");
+}
+
+void tiles_quit(void)
+{
+    pthread_mutex_lock(&pool_lock);
+    stopping = 1;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (int i = 1; i < nworkers; i++)
+        pthread_join(threads[i], NULL);
+    for (int i = 0; i < nworkers; i++)
+        pthread_mutex_destroy(&ranges[i].lock);
+
+    free(threads);
+    free(ranges);
+}
+
+void render_tiles(int w, int h, tile_func func, void * data)
+{
+    if (w <= 0 || h <= 0)
+        return;
+
+    int cols = (w + TILE_SIZE - 1) / TILE_SIZE;
+    int rows = (h + TILE_SIZE - 1) / TILE_SIZE;
+    int count = cols * rows;
+
+    pthread_mutex_lock(&pool_lock);
+
+    // Late helpers of the previous frame must be gone before the ranges
+    // are reset.
+    while (busy)
+        pthread_cond_wait(&pool_idle, &pool_lock);
+
+    // Every worker starts with a contiguous band of tiles.
+    for (int i = 0; i < nworkers; i++)
+    {
+        pthread_mutex_lock(&ranges[i].lock);
+        ranges[i].head = (int) ((long) count * i / nworkers);
+        ranges[i].tail = (int) ((long) count * (i + 1) / nworkers);
+        pthread_mutex_unlock(&ranges[i].lock);
+    }
+
+    current.func = func;
+    current.data = data;
+    current.w = w;
+    current.h = h;
+    current.cols = cols;
+    struct job job = current;
+    generation++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    work(0, &job);
+
+    // Waits for the tiles still being rendered by the helpers.
+    pthread_mutex_lock(&pool_lock);
+    while (busy)
+        pthread_cond_wait(&pool_idle, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+}
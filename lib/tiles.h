@@ -0,0 +1,24 @@
+#ifndef TILES_H
+#define TILES_H
+
+// Size (in pixels) of the side of a tile.
+#define TILE_SIZE 32
+
+// Function called by the workers for every tile of a frame.
+//
+// data: User data given to render_tiles().
+// x: Abscissa of the top left corner of the tile.
+// y: Ordinate of the top left corner of the tile.
+// w: Width of the tile.
+// h: Height of the tile.
+typedef void (*tile_func)(void * data, int x, int y, int w, int h);
+
+// Starts the thread pool (one worker per online core, the caller included).
+void tiles_init(void);
+// Stops the thread pool.
+void tiles_quit(void);
+// Splits a w x h frame into tiles and renders them on the thread pool.
+// Returns once every tile has been rendered.
+void render_tiles(int w, int h, tile_func func, void * data);
+
+#endif
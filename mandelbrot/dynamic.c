@@ -1,163 +1,647 @@
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 #include <err.h>
 #include <SDL2/SDL.h>
+#include "app.h"
+#include "tiles.h"
+#include "kernel.h"
+#include "deep.h"
+#include "escape.h"
+#include "palette.h"
 
 // Initial width and height of the window.
 int WIDTH = 640;
 int HEIGHT = 400;
 
-// Number max of iteration for mandelbrot calculation
+// Number max of iteration for mandelbrot calculation (at zoom 1)
 #define MAX_ITER 64
+
+// Parameters of a frame: formula, point of the plane at the center of the
+// window (in double-double, for deep zooms), zoom factor (1 shows the
+// rectangle [-1.5, 0.5] x [-1, 1] of the Mandelbrot set), iterations and
+// palette. VIEW is the state of the app: only the events change it, the
+// frames are drawn from snapshots of it.
+struct view
+{
+    // Formula, selected with the 'f' key, and constant of the Julia set,
+    // set by the position of the mouse.
+    struct escape escape;
+    struct dd x;
+    struct dd y;
+    double zoom;
+    // Fraction of the iteration range selected with the mouse, and the
+    // matching number of iterations.
+    double iter_ratio;
+    int iter;
+    // Index of the palette in PALETTES (the 'p' key selects the next one).
+    int palette;
+};
+struct view VIEW = { { MANDELBROT, -0.8, 0.156 }, { -0.5, 0 }, { 0, 0 }, 1, 1, MAX_ITER, 1 };
+
+// Center and zoom of the first view of every formula.
+struct home
+{
+    double x;
+    double y;
+    double zoom;
+};
+const struct home HOMES[FORMULAS] =
+{
+    [MANDELBROT] = { -0.5, 0, 1 },
+    [JULIA] = { 0, 0, 1.5 },
+    [MULTIBROT3] = { 0, 0, 1.5 },
+    [MULTIBROT4] = { 0, 0, 1.5 },
+    [BURNING_SHIP] = { -0.5, -0.5, 1.5 },
+    [TRICORN] = { -0.25, 0, 1.5 },
+};
+
+// Palettes of the frames.
+struct palettes PALETTES;
+
+// Formula, viewport and iterations of the frame being drawn (render
+// thread).
+struct escape ESCAPE = { MANDELBROT, 0, 0 };
+struct dd VIEW_X = { -0.5, 0 };
+struct dd VIEW_Y = { 0, 0 };
+double ZOOM = 1;
 int ITER = MAX_ITER;
-int GAP;
-
-// Verify whether the given number is in the set
-int mandelbrot(int Px, int Py);
-// Initialize a rect
-SDL_Rect * init_rect(int x, int y, int w, int h);
-// Draw a square o 1 pixel
-void draw_square(SDL_Surface * surface, int x, int y, int m);
+
+// Zoom below which double precision is not enough and the deep zoom
+// engine is used, and zoom at which double-double runs out of precision.
+// The deep zoom engine only iterates the Mandelbrot set: the other formulas
+// stop at DEEP_ZOOM.
+#define DEEP_ZOOM 1e-10
+#define MIN_ZOOM 1e-28
+
+// Reference orbit of the deep zoom engine.
+struct reference REFERENCE;
+
+// Orbits of the pixels, kept between frames: raising ITER only resumes the
+// orbits that have not escaped yet, lowering it or changing the palette
+// needs no iteration at all (a pixel shows the smallest of its count and
+// ITER).
+struct orbits
+{
+    double * zx;
+    double * zy;
+    int * n;
+    // Normalized iteration counts (see mandelbrot_smooth_count()).
+    float * values;
+    int w;
+    int h;
+    // Formula and viewport the orbits were computed for.
+    struct escape escape;
+    struct dd x;
+    struct dd y;
+    double zoom;
+    // Number of iterations every orbit has been computed up to.
+    int iter;
+    // Whether no frame of the view has been completed yet (the frames of
+    // the view were cancelled): the next one is computed progressively.
+    int partial;
+};
+struct orbits ORBITS;
+
+// Iterations skipped by the interior checks during the last frame.
+long SKIPPED;
+
+// Whether tiles of the last frame have been skipped, the frame being
+// cancelled (see app_cancelled()).
+int CANCELLED;
+
+// Side of the blocks of pixels of the pass being computed: a pass only
+// computes the top left pixel of every block. A new view is computed 8x8,
+// then 4x4 and 2x2 blocks, each pass being shown as a preview, then every
+// pixel.
+#define FIRST_PASS 8
+int PASS = 1;
+// Whether the pass refines the previous one: the top left pixels of the
+// blocks twice larger have already been computed, and are skipped.
+int REFINING;
+
+// Offset from the center of the view of the point shown by a column
+double offset_x(int Px);
+// Offset from the center of the view of the point shown by a row
+double offset_y(int Py);
+// Abscissa of the point of the plane shown by a column
+double plane_x(int Px);
+// Ordinate of the point of the plane shown by a row
+double plane_y(int Py);
+// Write the colors of the iterations into the surface
+void draw_pixels(SDL_Surface * surface, const float * values, int w, int h, int block,
+        struct palette * palette);
+// Columns of a row of a tile computed by the current pass
+int pass_columns(int x, int j, int * step);
+// Restart the orbits of every pixel from 0
+void reset_orbits(int w, int h);
+// Resume the orbits of a tile
+void render_tile(void * data, int x, int y, int w, int h);
+// Iterate a tile with the deep zoom engine
+void deep_tile(void * data, int x, int y, int w, int h);
+// Highest iteration count selectable at a zoom
+int max_iter(double zoom);
+// Select a fraction of the iteration range
+void set_iter(struct view * view, double ratio);
+// Zoom around a point of the window
+void zoom_at(struct view * view, int mx, int my, int w, int h, double factor);
+// Move the view
+void pan(struct view * view, int dx, int dy, int w, int h);
+// Select a formula
+void set_formula(struct view * view, enum formula formula);
+// Set the constant of the Julia set from a point of the window
+void set_constant(struct view * view, int mx, int my, int w, int h);
+// Compute the frame and write it into the surface
+void render(SDL_Surface * surface, int w, int h, struct palette * palette);
 // Draw mandlebrot
-void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h);
-// Loop to verify if an event is trigered
-void event_loop(SDL_Renderer * renderer);
+void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h, const void * state);
+// Handle the events of the window
+int event(const SDL_Event * event, int w, int h, void * state);
 
 
-int mandelbrot(int Px, int Py) 
+// Offset from the center of the view of the point shown by a column.
+double offset_x(int Px)
 {
-    double x0 = (double)Px/((double)WIDTH-(double)WIDTH/2) - 1.5;
-    double y0 = (double)Py/((double)HEIGHT-(double)HEIGHT/2) - 1;
-    int n = 0;
-    double tmp;
-    double x = 0, y = 0;
-    while (x*x + y*y <= 4 && n < ITER)
-    {
-        tmp = x*x - y*y + x0;;
-        y = 2*x*y + y0;
-        x = tmp;
-        n++;
-    }
-    return n;
+    return ((double)Px - (double)WIDTH/2) * 2 * ZOOM / WIDTH;
 }
 
+// Offset from the center of the view of the point shown by a row.
+double offset_y(int Py)
+{
+    return ((double)Py - (double)HEIGHT/2) * 2 * ZOOM / HEIGHT;
+}
 
-// Initialize a rect
-SDL_Rect * init_rect(int x, int y, int w, int h)
+// Abscissa of the point of the plane shown by a column of the window.
+double plane_x(int Px)
 {
-    SDL_Rect * rect = calloc(1, sizeof(SDL_Rect));
+    return VIEW_X.hi + offset_x(Px);
+}
 
-    if (!rect)
-        errx(EXIT_FAILURE, "Unable to generate a rectangle");
+// Ordinate of the point of the plane shown by a row of the window.
+double plane_y(int Py)
+{
+    return VIEW_Y.hi + offset_y(Py);
+}
 
-    rect->x = x;
-    rect->y = y;
-    rect->w = w;
-    rect->h = h;
+// Highest iteration count selectable at a zoom: deeper views need more
+// iterations to show their details.
+//
+// zoom: Zoom factor.
+int max_iter(double zoom)
+{
+    return MAX_ITER * (1 + (zoom < 1 ? (int) log2(1 / zoom) : 0));
+}
 
-    return rect;
+// Select a fraction of the iteration range.
+//
+// view: Parameters of the frames.
+// ratio: Fraction (0 to 1) of max_iter().
+void set_iter(struct view * view, double ratio)
+{
+    view->iter_ratio = ratio;
+    view->iter = (int) (max_iter(view->zoom) * ratio);
+    if (view->iter < 1)
+        view->iter = 1;
 }
 
+// Zoom around a point of the window, which stays in place.
+//
+// view: Parameters of the frames.
+// mx: Abscissa of the point.
+// my: Ordinate of the point.
+// w: Width of the window.
+// h: Height of the window.
+// factor: Zoom factor (below 1 to zoom in).
+void zoom_at(struct view * view, int mx, int my, int w, int h, double factor)
+{
+    double zoom = view->zoom * factor;
+    double min = view->escape.formula == MANDELBROT ? MIN_ZOOM : DEEP_ZOOM;
+    if (zoom < min || zoom > 4)
+        return;
 
+    // Offset of the point from the center of the view.
+    double dx = ((double) mx - (double) w/2) * 2 * view->zoom / w;
+    double dy = ((double) my - (double) h/2) * 2 * view->zoom / h;
 
-// Draw a square of 1 pixel
-void draw_square(SDL_Surface * surface, int x, int y, int m)
+    view->x = dd_add_d(view->x, dx * (1 - factor));
+    view->y = dd_add_d(view->y, dy * (1 - factor));
+    view->zoom = zoom;
+    set_iter(view, view->iter_ratio);
+}
+
+// Move the view.
+//
+// view: Parameters of the frames.
+// dx: Horizontal move of the mouse, in pixels.
+// dy: Vertical move of the mouse, in pixels.
+// w: Width of the window.
+// h: Height of the window.
+void pan(struct view * view, int dx, int dy, int w, int h)
 {
-    SDL_Rect * rect = init_rect(x,y,1,1);
-    Uint8 v = 255 - (m * 255 / ITER);
-    SDL_FillRect(surface, rect, SDL_MapRGB(surface->format,v/3,v/3,v));
-    free(rect);
+    view->x = dd_add_d(view->x, -dx * 2 * view->zoom / w);
+    view->y = dd_add_d(view->y, -dy * 2 * view->zoom / h);
 }
 
-// Draw squares that verifies that are in the mandelbrot
-void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h)
+// Select a formula, and go back to its first view.
+//
+// view: Parameters of the frames.
+// formula: Formula.
+void set_formula(struct view * view, enum formula formula)
 {
-    // Clears the renderer (sets the background to black).
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+    view->escape.formula = formula;
+    view->x = dd_from(HOMES[formula].x);
+    view->y = dd_from(HOMES[formula].y);
+    view->zoom = HOMES[formula].zoom;
+    set_iter(view, view->iter_ratio);
+}
 
-    for (int x = 0; x < w; x++)
-        for (int y = 0; y < h; y++)
-            draw_square(surface, x, y, mandelbrot(x, y));
+// Set the constant of the Julia set to the point of the first view of the
+// Mandelbrot set under a point of the window, so that the whole window
+// sweeps the set.
+//
+// view: Parameters of the frames.
+// mx: Abscissa of the point.
+// my: Ordinate of the point.
+// w: Width of the window.
+// h: Height of the window.
+void set_constant(struct view * view, int mx, int my, int w, int h)
+{
+    const struct home * home = &HOMES[MANDELBROT];
+    view->escape.kx = home->x + ((double) mx - (double) w/2) * 2 * home->zoom / w;
+    view->escape.ky = home->y + ((double) my - (double) h/2) * 2 * home->zoom / h;
+}
 
-    // Create a Texture to apply on the render
-    SDL_Texture * texture = SDL_CreateTextureFromSurface(renderer, surface);
 
-    // Applying texture
-    SDL_Rect * rect = init_rect(0,0,w,h);
-    SDL_RenderCopy(renderer, texture, NULL, rect); 
-    free(rect);
-    //free(texture);
+// Write the colors of the iterations straight into the pixels of the
+// surface, row by row (see palette_apply()).
+//
+// surface: Surface to draw on (32 bits per pixel).
+// values: Normalized iteration counts of the frame (counts of ITER or more
+// are shown as the set).
+// w: Width of the frame.
+// h: Height of the frame.
+// block: Side of the blocks of pixels showing the count of their top left
+// pixel (1 to show every pixel).
+// palette: Palette of the frame.
+void draw_pixels(SDL_Surface * surface, const float * values, int w, int h, int block,
+        struct palette * palette)
+{
+    int sw = w < surface->w ? w : surface->w;
+    int sh = h < surface->h ? h : surface->h;
+
+    palette_map(palette, surface->format);
+
+    if (SDL_LockSurface(surface) != 0)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
 
-    // Updates the display.
-    SDL_RenderPresent(renderer);
+    Uint8 * pixels = surface->pixels;
+    for (int y = 0; y < sh; y++)
+    {
+        Uint32 * row = (Uint32 *) (pixels + y * surface->pitch);
+        if (y % block != 0)
+        {
+            memcpy(row, pixels + (y - y % block) * surface->pitch, sw * sizeof(Uint32));
+            continue;
+        }
+
+        palette_apply(palette, values + (size_t) y * w, sw, ITER, row);
+        for (int x = 0; x < sw && block > 1; x++)
+            row[x] = row[x - x % block];
+    }
+
+    SDL_UnlockSurface(surface);
+}
+
+// Restart the orbits of every pixel from 0.
+//
+// w: Width of the frame.
+// h: Height of the frame.
+void reset_orbits(int w, int h)
+{
+    size_t size = (size_t) w * h;
+
+    ORBITS.zx = realloc(ORBITS.zx, size * sizeof(double));
+    ORBITS.zy = realloc(ORBITS.zy, size * sizeof(double));
+    ORBITS.n = realloc(ORBITS.n, size * sizeof(int));
+    ORBITS.values = realloc(ORBITS.values, size * sizeof(float));
+    if (!ORBITS.zx || !ORBITS.zy || !ORBITS.n || !ORBITS.values)
+        errx(EXIT_FAILURE, "Unable to allocate the orbits");
+
+    memset(ORBITS.zx, 0, size * sizeof(double));
+    memset(ORBITS.zy, 0, size * sizeof(double));
+    memset(ORBITS.n, 0, size * sizeof(int));
+    memset(ORBITS.values, 0, size * sizeof(float));
+    ORBITS.w = w;
+    ORBITS.h = h;
+    ORBITS.escape = ESCAPE;
+    ORBITS.x = VIEW_X;
+    ORBITS.y = VIEW_Y;
+    ORBITS.zoom = ZOOM;
+    ORBITS.iter = 0;
+    ORBITS.partial = 1;
 }
 
-// Event loop that calls the relevant event handler.
+// First column of a row of a tile computed by the current pass (see PASS),
+// or -1 if the pass skips the row.
 //
-// renderer: Renderer to draw on.
-void event_loop(SDL_Renderer* renderer)
-{
-    // Draws the fractal
-    SDL_Surface * surface = SDL_CreateRGBSurface(0,WIDTH,HEIGHT,32,0,0,0,0);
-    draw(renderer, surface, WIDTH, HEIGHT);
-    
-    int last_x = 0;
-    // Creates a variable to get the events.
-    SDL_Event event;
-
-    while (1)
+// x: Abscissa of the left of the tile (a multiple of FIRST_PASS).
+// j: Row.
+// step: Set to the distance between the columns of the pass.
+int pass_columns(int x, int j, int * step)
+{
+    *step = PASS;
+    if (j % PASS != 0)
+        return -1;
+
+    // Every other column of the rows of the previous pass is already known.
+    if (REFINING && j % (2 * PASS) == 0)
     {
-        // Waits for an event.
-        SDL_WaitEvent(&event);
+        *step = 2 * PASS;
+        return x + PASS;
+    }
+
+    return x;
+}
 
-        switch (event.type)
+// Resume the orbits of the pixels of a tile computed by the current pass up
+// to ITER.
+//
+// data: Orbits of the frame.
+// x: Abscissa of the top left corner of the tile.
+// y: Ordinate of the top left corner of the tile.
+// w: Width of the tile.
+// h: Height of the tile.
+void render_tile(void * data, int x, int y, int w, int h)
+{
+    struct orbits * orbits = data;
+    escape_func resume = escape_kernel(ESCAPE.formula);
+    double cx[TILE_SIZE];
+    double cy[TILE_SIZE];
+    double zx[TILE_SIZE];
+    double zy[TILE_SIZE];
+    int n[TILE_SIZE];
+
+    // The frame will not be displayed (the orbits of the other tiles are
+    // resumed by the next one).
+    if (app_cancelled())
+    {
+        __atomic_store_n(&CANCELLED, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // Iterates the tile row by row with the vectorized kernel
+    long skipped = 0;
+    for (int j = y; j < y + h; j++)
+    {
+        int step;
+        int first = pass_columns(x, j, &step);
+        if (first < 0)
+            continue;
+
+        double c = plane_y(j);
+        size_t offset = (size_t) j * orbits->w;
+        if (step == 1)
         {
-            // If the "quit" button is pushed, ends the event loop.
-            case SDL_QUIT:
-                return;
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    WIDTH = event.window.data1;
-                    HEIGHT = event.window.data2;
-                    draw(renderer, surface, WIDTH, HEIGHT);
-                }
-                break;
-            case SDL_MOUSEMOTION :
-                GAP = WIDTH/10;
-                if (GAP + last_x < event.motion.x || last_x - GAP > event.motion.x)
-                {
-                    last_x = event.motion.x;
-                    ITER = (int) ((double)MAX_ITER * ((double) event.motion.x + 1.0) / WIDTH);
-                    draw(renderer, surface, WIDTH, HEIGHT);
-                }
+            for (int i = 0; i < w; i++)
+            {
+                cx[i] = plane_x(x + i);
+                cy[i] = c;
+            }
+            skipped += resume(&ESCAPE, cx, cy, orbits->zx + offset + x, orbits->zy + offset + x,
+                    orbits->n + offset + x, w, ITER);
+            for (size_t i = offset + x; i < offset + x + w; i++)
+                orbits->values[i] = escape_smooth_count(&ESCAPE, cx[i - offset - x], c, orbits->n[i],
+                        orbits->zx[i], orbits->zy[i]);
+            continue;
+        }
+
+        // Gathers the pixels of the pass, then scatters their orbits back.
+        int count = 0;
+        for (int i = first; i < x + w; i += step, count++)
+        {
+            cx[count] = plane_x(i);
+            cy[count] = c;
+            zx[count] = orbits->zx[offset + i];
+            zy[count] = orbits->zy[offset + i];
+            n[count] = orbits->n[offset + i];
+        }
+        skipped += resume(&ESCAPE, cx, cy, zx, zy, n, count, ITER);
+        for (int i = first, k = 0; k < count; i += step, k++)
+        {
+            orbits->zx[offset + i] = zx[k];
+            orbits->zy[offset + i] = zy[k];
+            orbits->n[offset + i] = n[k];
+            orbits->values[offset + i] = escape_smooth_count(&ESCAPE, cx[k], c, n[k], zx[k], zy[k]);
         }
     }
+    __atomic_fetch_add(&SKIPPED, skipped, __ATOMIC_RELAXED);
 }
 
-int main()
+// Iterate the pixels of a tile computed by the current pass with the deep
+// zoom engine (perturbation of the reference orbit of the center of the
+// view).
+//
+// data: Orbits of the frame (the orbits are not resumed, they only keep
+// their point of escape).
+// x: Abscissa of the top left corner of the tile.
+// y: Ordinate of the top left corner of the tile.
+// w: Width of the tile.
+// h: Height of the tile.
+void deep_tile(void * data, int x, int y, int w, int h)
 {
-    // Initializes the SDL.
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    struct orbits * orbits = data;
 
-    // Creates a window.
-    SDL_Window* window = SDL_CreateWindow("Mandelbrot", 0, 0, WIDTH, HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (window == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    // The frame will not be displayed.
+    if (app_cancelled())
+    {
+        __atomic_store_n(&CANCELLED, 1, __ATOMIC_RELAXED);
+        return;
+    }
 
-    // Creates a renderer.
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    for (int j = y; j < y + h; j++)
+    {
+        int step;
+        int first = pass_columns(x, j, &step);
+        if (first < 0)
+            continue;
+
+        double dy = offset_y(j);
+        size_t offset = (size_t) j * orbits->w;
+        for (size_t i = offset + first; i < offset + x + w; i += step)
+        {
+            orbits->n[i] = deep_point(&REFERENCE, offset_x(i - offset), dy, ITER,
+                    &orbits->zx[i], &orbits->zy[i]);
+            orbits->values[i] = mandelbrot_smooth_count(plane_x(i - offset), plane_y(j), orbits->n[i],
+                    orbits->zx[i], orbits->zy[i]);
+        }
+    }
+}
+
+// Compute the frame on the thread pool and write it into the surface. A new
+// view is computed by passes of decreasing blocks (see PASS), each pass
+// being shown as a preview (see app_preview()): every pixel is still
+// computed once.
+//
+// surface: Surface to draw on.
+// w: Width of the frame.
+// h: Height of the frame.
+// palette: Palette of the frame.
+void render(SDL_Surface * surface, int w, int h, struct palette * palette)
+{
+    // Every pixel shows another point after a resize, a pan, a zoom or
+    // another formula (or constant of the Julia set): the view is computed
+    // progressively, until a frame of it is completed. Otherwise, only the
+    // iterations are resumed, at once.
+    if (ORBITS.w != w || ORBITS.h != h || ORBITS.zoom != ZOOM
+            || ORBITS.escape.formula != ESCAPE.formula
+            || ORBITS.escape.kx != ESCAPE.kx || ORBITS.escape.ky != ESCAPE.ky
+            || ORBITS.x.hi != VIEW_X.hi || ORBITS.x.lo != VIEW_X.lo
+            || ORBITS.y.hi != VIEW_Y.hi || ORBITS.y.lo != VIEW_Y.lo)
+        reset_orbits(w, h);
+    int first = ORBITS.partial ? FIRST_PASS : 1;
+
+    // Only iterates when ITER goes beyond what has been computed so far.
+    SKIPPED = 0;
+    CANCELLED = 0;
+    if (ITER > ORBITS.iter)
+    {
+        // The deep zoom engine does not keep the orbits: it iterates every
+        // pixel again from the reference orbit.
+        int deep = ESCAPE.formula == MANDELBROT && ZOOM < DEEP_ZOOM;
+        if (deep)
+            reference_compute(&REFERENCE, VIEW_X, VIEW_Y, ITER, ZOOM, ZOOM);
+
+        // A cancelled pass is neither shown nor refined.
+        for (PASS = first; PASS >= 1 && !CANCELLED; PASS /= 2)
+        {
+            REFINING = PASS < first;
+            render_tiles(w, h, deep ? deep_tile : render_tile, &ORBITS);
+            if (PASS > 1 && !CANCELLED)
+            {
+                draw_pixels(surface, ORBITS.values, w, h, PASS, palette);
+                surface = app_preview(surface);
+            }
+        }
+
+        // Some tiles may not have been iterated up to ITER.
+        if (!CANCELLED)
+        {
+            ORBITS.iter = ITER;
+            ORBITS.partial = 0;
+        }
+    }
+
+    draw_pixels(surface, ORBITS.values, w, h, 1, palette);
+}
+
+// Compute the frame into the surface and report its time.
+//
+// renderer: Unused (the frame is written into the surface).
+// surface: Surface to draw on.
+// w: Current width of the window.
+// h: Current height of the window.
+// state: Parameters of the frame (snapshot of VIEW).
+void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h, const void * state)
+{
+    (void) renderer;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    const struct view * view = state;
+    ESCAPE = view->escape;
+    VIEW_X = view->x;
+    VIEW_Y = view->y;
+    ZOOM = view->zoom;
+    ITER = view->iter;
+    WIDTH = w;
+    HEIGHT = h;
+    render(surface, w, h, &PALETTES.list[view->palette]);
+
+    // Reports the frame time
+    double ms = (double) (SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+    fprintf(stderr, "frame %dx%d, %s, %d iterations (%ld skipped), zoom %g: %.2f ms%s\n",
+            w, h, escape_name(ESCAPE.formula), ITER, SKIPPED, ZOOM, ms,
+            CANCELLED ? " (cancelled)" : "");
+}
+
+// The wheel zooms around the cursor, dragging with the left button pans
+// the view, the horizontal position of the mouse sets the iterations (or
+// the constant of the Julia set), the 'f' key selects the next formula and
+// the 'p' key the next palette.
+int event(const SDL_Event * event, int w, int h, void * state)
+{
+    struct view * view = state;
+    int mouse_x, mouse_y;
+
+    switch (event->type)
+    {
+        case SDL_KEYDOWN:
+            switch (event->key.keysym.sym)
+            {
+                case SDLK_f:
+                    set_formula(view, (view->escape.formula + 1) % FORMULAS);
+                    return 1;
+                case SDLK_p:
+                    view->palette = (view->palette + 1) % PALETTES.count;
+                    return 1;
+            }
+            return 0;
+        case SDL_MOUSEWHEEL:
+            if (event->wheel.y == 0)
+                return 0;
+            SDL_GetMouseState(&mouse_x, &mouse_y);
+            zoom_at(view, mouse_x, mouse_y, w, h, event->wheel.y > 0 ? 0.5 : 2);
+            return 1;
+        case SDL_MOUSEMOTION :
+            if (event->motion.state & SDL_BUTTON_LMASK)
+            {
+                pan(view, event->motion.xrel, event->motion.yrel, w, h);
+                return 1;
+            }
+            if (view->escape.formula == JULIA)
+            {
+                set_constant(view, event->motion.x, event->motion.y, w, h);
+                return 1;
+            }
+            {
+                // Only a new iteration count changes the frame.
+                int iter = view->iter;
+                set_iter(view, ((double) event->motion.x + 1.0) / w);
+                return view->iter != iter;
+            }
+    }
+
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    // Parses the options of the headless mode.
+    struct headless headless;
+    argc = headless_parse(&headless, argc, argv, WIDTH, HEIGHT);
+    argc = palette_parse(&PALETTES, &VIEW.palette, argc, argv);
+
+    // Parses the formula.
+    int formula = 0;
+    if (argc == 3 && strcmp(argv[1], "--formula") == 0)
+    {
+        while (formula < FORMULAS && strcmp(argv[2], escape_name(formula)) != 0)
+            formula++;
+        if (formula == FORMULAS)
+            errx(EXIT_FAILURE, "Unknown formula: %s", argv[2]);
+    }
+    else if (argc != 1)
+        errx(EXIT_FAILURE, "Usage: %s [--formula NAME] [--palette FILE]", argv[0]);
+    set_formula(&VIEW, formula);
 
-    // Dispatches the events.
-    event_loop(renderer);
+    // Selects the kernel and starts the render threads.
+    kernel_init();
+    tiles_init();
 
-    // Destroys the objects.
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    struct app app = { "Mandelbrot", WIDTH, HEIGHT, 1, draw, event, &VIEW, sizeof(VIEW) };
+    int status = app_run(&app, &headless);
 
-    return EXIT_SUCCESS;
+    reference_free(&REFERENCE);
+    tiles_quit();
+    return status;
 }
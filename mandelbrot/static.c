@@ -1,155 +1,960 @@
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 #include <err.h>
 #include <SDL2/SDL.h>
+#include "app.h"
+#include "export.h"
+#include "tiles.h"
+#include "kernel.h"
+#include "palette.h"
+#include "pyramid.h"
+#include "rng.h"
 
 // Initial width and height of the window.
 int WIDTH = 1280;
 int HEIGHT = 800;
 
+// Part of the plane shown by the image: point of its top left pixel, and
+// size of its pixels. A window shows the whole image in a frame, while a
+// headless image is rendered in bands of BAND rows (--band ROWS), each one
+// a frame, TOP being the number of rows of the image above the frame (a
+// pyramid is rendered tile by tile, each one an image).
+struct view
+{
+    double x;
+    double y;
+    double dx;
+    double dy;
+};
+struct view VIEW = { -1.5, -1, 2.0 / 1280, 2.0 / 800 };
+int TOP = 0;
+#define DEFAULT_BAND 128
+int BAND = DEFAULT_BAND;
+
+// Tile pyramid (--tiles DIR): level z covers the square of side
+// PYRAMID_SIDE around the set with 2^z x 2^z tiles, for the LEVELS levels
+// (--levels N).
+#define PYRAMID_X -2.25
+#define PYRAMID_Y -1.5
+#define PYRAMID_SIDE 3.0
+#define MAX_LEVELS 24
+const char * TILES;
+int LEVELS = 6;
+// Tiles of the pyramid found inside the set without computing them.
+long INSIDE;
+
 // Number max of iteration for mandelbrot calculation
 #define MAX_ITER 2048
 int ITER = MAX_ITER;
 
-// Verify whether the given number is in the set
-int mandelbrot(int Px, int Py);
-// Initialize a rect
-SDL_Rect * init_rect(int x, int y, int w, int h);
-// Draw a square o 1 pixel
-void draw_square(SDL_Surface * surface, int x, int y, int m);
+// Iterations skipped by the interior checks during the last frame.
+long SKIPPED;
+
+// Render modes: every pixel is iterated (BRUTE), or the rectangles whose
+// border has a single iteration count are filled without iterating their
+// interior (SUBDIVIDE, Mariani-Silver). The 'm' key switches between them.
+enum mode { BRUTE, SUBDIVIDE };
+
+// Parameters of a frame: render mode, palette (index in PALETTES, the 'p'
+// key selects the next one) and side of the grid of samples of the
+// supersampled pixels (1 without anti-aliasing, the 'a' key switches
+// between 1 and SSAA). SETTINGS is the state of the app, the frames are
+// drawn from snapshots of it.
+struct settings
+{
+    enum mode mode;
+    int palette;
+    int ssaa;
+};
+struct settings SETTINGS = { BRUTE, 0, 1 };
+
+// Anti-aliasing: the pixels whose normalized iteration count differs from
+// that of a neighbour by more than SSAA_THRESHOLD (or that are in the set
+// while a neighbour is not) are the boundaries of the frame. They get the
+// average color of SSAA x SSAA samples, each one at a random point of its
+// cell of the pixel (jittered grid), so the cost grows with the length of
+// the boundaries rather than with the area of the frame.
+#define SSAA_MAX 8
+#define SSAA_THRESHOLD 1.0f
+int SSAA = 4;
+// Seed of the jitter: a frame always gets the same samples.
+#define SSAA_SEED 0x55aa
+
+// Supersampled pixels of the last frame: whether every pixel is
+// supersampled, the index of the supersampled ones in the frame, and their
+// side * side normalized iteration counts.
+struct supersamples
+{
+    unsigned char * marks;
+    int * pixels;
+    float * values;
+    int count;
+    int side;
+};
+struct supersamples SUPERSAMPLES;
+
+// Palettes of the frames.
+struct palettes PALETTES;
+
+// Normalized iteration counts of the last frame, kept while only the
+// palette changes.
+struct counts
+{
+    float * values;
+    int w;
+    int h;
+    enum mode mode;
+    // Side of the samples of the supersampled pixels.
+    int ssaa;
+    int valid;
+};
+struct counts COUNTS;
+
+// Interior area (in pixels) below which a rectangle is computed rather
+// than subdivided.
+#define SUBDIVIDE_AREA 64
+
+// Pixels filled without iterating during the last frame.
+long FILLED;
+
+// Abscissa of the point of the plane shown by a column
+double plane_x(double Px);
+// Ordinate of the point of the plane shown by a row
+double plane_y(double Py);
+// Write the colors of the iterations into the surface
+void draw_pixels(SDL_Surface * surface, const float * values, int w, int h, struct palette * palette);
+// Write the colors of the supersampled pixels into the surface
+void draw_supersamples(SDL_Surface * surface, int w, int h, struct palette * palette);
+// Compute the iterations of a row of pixels
+long compute_row(float * values, int x, int y, int w);
+// Compute the iterations of a column of pixels
+long compute_column(float * values, int x, int y, int h);
+// Compute the iterations of a block of pixels
+long compute_block(float * values, int x, int y, int w, int h);
+// Fill or split a rectangle whose border is computed
+long subdivide(float * values, int x, int y, int w, int h, long * filled);
+// Compute the iterations of a tile
+void render_tile(void * data, int x, int y, int w, int h);
+// Compute the iterations of a tile by subdivision
+void subdivide_tile(void * data, int x, int y, int w, int h);
+// Whether two neighbours are on a boundary of the frame
+int boundary(float a, float b);
+// Find the supersampled pixels of a tile
+void mark_tile(void * data, int x, int y, int w, int h);
+// Compute the samples of supersampled pixels
+void sample_tile(void * data, int x, int y, int w, int h);
+// Supersample the boundaries of the frame
+void supersample(int w, int h, int side);
+// Compute the iterations of points of the border of a frame
+void border_tile(void * data, int x, int y, int w, int h);
+// Whether the border of a frame is in the set
+int border_inside(int w, int h);
+// Fill the surface with the color of the set
+void fill_set(SDL_Surface * surface, struct palette * palette);
+// Render a tile of the pyramid and its descendants
+void render_pyramid(struct pyramid * pyramid, SDL_Surface * surface, int z, int x, int y, int inside);
+// Compute the frame and write it into the surface
+int render(SDL_Surface * surface, int w, int h, const struct settings * settings);
 // Draw mandlebrot
-void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h);
-// Loop to verify if an event is trigered
-void event_loop(SDL_Renderer * renderer);
+void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h, const void * state);
+// Handle the events of the window
+int event(const SDL_Event * event, int w, int h, void * state);
+// Render the headless image in bands
+int export_image(const struct headless * headless);
+// Render the tile pyramid
+int generate_pyramid(void);
+
+
+// Abscissa of the point of the plane shown by a column of the frame.
+double plane_x(double Px)
+{
+    return VIEW.x + Px * VIEW.dx;
+}
+
+// Ordinate of the point of the plane shown by a row of the frame.
+double plane_y(double Py)
+{
+    return VIEW.y + (Py + TOP) * VIEW.dy;
+}
 
 
-int mandelbrot(int Px, int Py) 
+// Write the colors of the iterations straight into the pixels of the
+// surface, row by row (see palette_apply()).
+//
+// surface: Surface to draw on (32 bits per pixel).
+// values: Normalized iteration counts of the frame.
+// w: Width of the frame.
+// h: Height of the frame.
+// palette: Palette of the frame.
+void draw_pixels(SDL_Surface * surface, const float * values, int w, int h, struct palette * palette)
 {
-    double x0 = (double)Px/((double)WIDTH-(double)WIDTH/2) - 1.5;
-    double y0 = (double)Py/((double)HEIGHT-(double)HEIGHT/2) - 1;
-    int n = 0;
-    double tmp;
-    double x = 0, y = 0;
-    while (x*x + y*y <= 4 && n < ITER)
+    int sw = w < surface->w ? w : surface->w;
+    int sh = h < surface->h ? h : surface->h;
+
+    palette_map(palette, surface->format);
+
+    if (SDL_LockSurface(surface) != 0)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    for (int y = 0; y < sh; y++)
+    {
+        Uint32 * row = (Uint32 *) ((Uint8 *) surface->pixels + y * surface->pitch);
+        palette_apply(palette, values + (size_t) y * w, sw, ITER, row);
+    }
+
+    SDL_UnlockSurface(surface);
+}
+
+// Write the average color of the samples of every supersampled pixel into
+// the surface. The colors are averaged byte by byte (every channel of a
+// 32-bit surface).
+//
+// surface: Surface to draw on (32 bits per pixel).
+// w: Width of the frame.
+// h: Height of the frame.
+// palette: Palette of the frame (mapped by draw_pixels()).
+void draw_supersamples(SDL_Surface * surface, int w, int h, struct palette * palette)
+{
+    int sw = w < surface->w ? w : surface->w;
+    int sh = h < surface->h ? h : surface->h;
+    int samples = SUPERSAMPLES.side * SUPERSAMPLES.side;
+    Uint32 colors[SSAA_MAX * SSAA_MAX];
+
+    if (SDL_LockSurface(surface) != 0)
+        errx(EXIT_FAILURE, "%s", SDL_GetError());
+
+    for (int k = 0; k < SUPERSAMPLES.count; k++)
     {
-        tmp = x*x - y*y + x0;;
-        y = 2*x*y + y0;
-        x = tmp;
-        n++;
+        int x = SUPERSAMPLES.pixels[k] % w;
+        int y = SUPERSAMPLES.pixels[k] / w;
+        if (x >= sw || y >= sh)
+            continue;
+
+        palette_apply(palette, SUPERSAMPLES.values + (size_t) k * samples, samples, ITER, colors);
+        Uint32 sums[4] = { 0, 0, 0, 0 };
+        for (int s = 0; s < samples; s++)
+            for (int b = 0; b < 4; b++)
+                sums[b] += colors[s] >> (8 * b) & 0xff;
+
+        Uint32 color = 0;
+        for (int b = 0; b < 4; b++)
+            color |= (sums[b] + samples / 2) / samples << (8 * b);
+        ((Uint32 *) ((Uint8 *) surface->pixels + y * surface->pitch))[x] = color;
+    }
+
+    SDL_UnlockSurface(surface);
+}
+
+// Compute the iterations of a row of pixels with the vectorized kernel.
+// Returns the number of iterations skipped by the kernel.
+//
+// values: Iteration counts of the frame (one per pixel, WIDTH per row).
+// x: Abscissa of the first pixel.
+// y: Ordinate of the row.
+// w: Number of pixels (at most TILE_SIZE).
+long compute_row(float * values, int x, int y, int w)
+{
+    double cx[TILE_SIZE];
+    double cy[TILE_SIZE];
+
+    double c = plane_y(y);
+    for (int i = 0; i < w; i++)
+    {
+        cx[i] = plane_x(x + i);
+        cy[i] = c;
     }
-    return n;
+
+    return mandelbrot_smooth(cx, cy, w, ITER, values + y * WIDTH + x);
 }
 
+// Compute the iterations of a column of pixels with the vectorized kernel.
+// Returns the number of iterations skipped by the kernel.
+//
+// values: Iteration counts of the frame (one per pixel, WIDTH per row).
+// x: Abscissa of the column.
+// y: Ordinate of the first pixel.
+// h: Number of pixels (at most TILE_SIZE).
+long compute_column(float * values, int x, int y, int h)
+{
+    double cx[TILE_SIZE];
+    double cy[TILE_SIZE];
+    float out[TILE_SIZE];
+
+    if (h <= 0)
+        return 0;
+
+    double c = plane_x(x);
+    for (int j = 0; j < h; j++)
+    {
+        cx[j] = c;
+        cy[j] = plane_y(y + j);
+    }
+
+    long skipped = mandelbrot_smooth(cx, cy, h, ITER, out);
+    for (int j = 0; j < h; j++)
+        values[(y + j) * WIDTH + x] = out[j];
+    return skipped;
+}
 
-// Initialize a rect
-SDL_Rect * init_rect(int x, int y, int w, int h)
+// Compute the iterations of a block of pixels with a single call to the
+// vectorized kernel, so that narrow blocks still fill its lanes. Returns
+// the number of iterations skipped by the kernel.
+//
+// values: Iteration counts of the frame (one per pixel, WIDTH per row).
+// x: Abscissa of the top left corner of the block.
+// y: Ordinate of the top left corner of the block.
+// w: Width of the block.
+// h: Height of the block (w * h at most TILE_SIZE * TILE_SIZE).
+long compute_block(float * values, int x, int y, int w, int h)
 {
-    SDL_Rect * rect = calloc(1, sizeof(SDL_Rect));
+    double cx[TILE_SIZE * TILE_SIZE];
+    double cy[TILE_SIZE * TILE_SIZE];
+    float out[TILE_SIZE * TILE_SIZE];
+    int count = 0;
 
-    if (!rect)
-        errx(EXIT_FAILURE, "Unable to generate a rectangle");
+    for (int j = y; j < y + h; j++)
+    {
+        double c = plane_y(j);
+        for (int i = x; i < x + w; i++)
+        {
+            cx[count] = plane_x(i);
+            cy[count] = c;
+            count++;
+        }
+    }
 
-    rect->x = x;
-    rect->y = y;
-    rect->w = w;
-    rect->h = h;
+    if (count == 0)
+        return 0;
 
-    return rect;
+    long skipped = mandelbrot_smooth(cx, cy, count, ITER, out);
+    for (int j = 0; j < h; j++)
+        memcpy(values + (y + j) * WIDTH + x, out + j * w, w * sizeof(float));
+    return skipped;
 }
 
+// Fill a rectangle whose border is computed if the whole border has the
+// same normalized iteration count; otherwise compute the line that splits
+// it in two along its longest side and do the same with both halves. Small
+// rectangles are computed pixel by pixel. Returns the number of iterations
+// skipped by the kernel.
+//
+// The counts are compared exactly: the normalized counts of the points
+// outside the set are continuous, so in practice only the rectangles in the
+// set (all of whose border reaches ITER) are filled, while the integer
+// counts used to fill the bands of the outside too.
+//
+// values: Iteration counts of the frame (one per pixel, WIDTH per row).
+// x: Abscissa of the top left corner of the rectangle.
+// y: Ordinate of the top left corner of the rectangle.
+// w: Width of the rectangle (border included).
+// h: Height of the rectangle (border included).
+// filled: Incremented by the number of pixels filled.
+long subdivide(float * values, int x, int y, int w, int h, long * filled)
+{
+    if (w <= 2 || h <= 2)
+        return 0;
+
+    float * top = values + y * WIDTH + x;
+    float * bottom = values + (y + h - 1) * WIDTH + x;
+    float n = top[0];
+    int uniform = 1;
+
+    for (int i = 0; i < w && uniform; i++)
+        uniform = top[i] == n && bottom[i] == n;
+    for (int j = 1; j < h - 1 && uniform; j++)
+        uniform = top[j * WIDTH] == n && top[j * WIDTH + w - 1] == n;
+
+    if (uniform)
+    {
+        for (int j = 1; j < h - 1; j++)
+            for (int i = 1; i < w - 1; i++)
+                top[j * WIDTH + i] = n;
+        *filled += (long) (w - 2) * (h - 2);
+        return 0;
+    }
 
+    long skipped = 0;
+    if ((w - 2) * (h - 2) <= SUBDIVIDE_AREA || w <= 4 || h <= 4)
+        skipped += compute_block(values, x + 1, y + 1, w - 2, h - 2);
+    else if (w >= h)
+    {
+        int mid = x + w / 2;
+        skipped += compute_column(values, mid, y + 1, h - 2);
+        skipped += subdivide(values, x, y, mid - x + 1, h, filled);
+        skipped += subdivide(values, mid, y, x + w - mid, h, filled);
+    }
+    else
+    {
+        int mid = y + h / 2;
+        skipped += compute_row(values, x + 1, mid, w - 2);
+        skipped += subdivide(values, x, y, w, mid - y + 1, filled);
+        skipped += subdivide(values, x, mid, w, y + h - mid, filled);
+    }
+    return skipped;
+}
 
-// Draw a square of 1 pixel
-void draw_square(SDL_Surface * surface, int x, int y, int m)
+// Compute the iterations of the pixels of a tile.
+//
+// data: Iteration counts of the frame (one per pixel, WIDTH per row).
+// x: Abscissa of the top left corner of the tile.
+// y: Ordinate of the top left corner of the tile.
+// w: Width of the tile.
+// h: Height of the tile.
+void render_tile(void * data, int x, int y, int w, int h)
 {
-    SDL_Rect * rect = init_rect(x,y,1,1);
-    Uint8 v = 255 - (m * 255 / ITER);
-    SDL_FillRect(surface, rect, SDL_MapRGB(surface->format,v,v,v));
-    free(rect);
+    float * values = data;
+
+    // The frame will not be displayed.
+    if (app_cancelled())
+        return;
+
+    // Iterates the tile row by row with the vectorized kernel
+    long skipped = 0;
+    for (int j = y; j < y + h; j++)
+        skipped += compute_row(values, x, j, w);
+    __atomic_fetch_add(&SKIPPED, skipped, __ATOMIC_RELAXED);
 }
 
-// Draw squares that verifies that are in the mandelbrot
-void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h)
+// Compute the iterations of the pixels of a tile: only its border is
+// iterated, then its interior is filled or subdivided.
+//
+// data: Iteration counts of the frame (one per pixel, WIDTH per row).
+// x: Abscissa of the top left corner of the tile.
+// y: Ordinate of the top left corner of the tile.
+// w: Width of the tile.
+// h: Height of the tile.
+void subdivide_tile(void * data, int x, int y, int w, int h)
 {
-    // Clears the renderer (sets the background to black).
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+    float * values = data;
+    long skipped = 0;
+    long filled = 0;
+
+    // The frame will not be displayed.
+    if (app_cancelled())
+        return;
+
+    skipped += compute_row(values, x, y, w);
+    if (h > 1)
+        skipped += compute_row(values, x, y + h - 1, w);
+    if (h > 2)
+    {
+        skipped += compute_column(values, x, y + 1, h - 2);
+        if (w > 1)
+            skipped += compute_column(values, x + w - 1, y + 1, h - 2);
+    }
 
-    // Sets the color for drawing operations to white.
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    skipped += subdivide(values, x, y, w, h, &filled);
 
-    for (int x = 0; x < w; x++)
-        for (int y = 0; y < h; y++)
-            draw_square(surface, x, y, mandelbrot(x, y));
+    __atomic_fetch_add(&SKIPPED, skipped, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&FILLED, filled, __ATOMIC_RELAXED);
+}
 
-    // Create a Texture to apply on the render
-    SDL_Texture * texture = SDL_CreateTextureFromSurface(renderer, surface);
+// Whether two neighbouring pixels are on a boundary of the frame.
+//
+// a: Normalized iteration count of a pixel.
+// b: Normalized iteration count of its neighbour.
+int boundary(float a, float b)
+{
+    return (a >= ITER) != (b >= ITER) || fabsf(a - b) > SSAA_THRESHOLD;
+}
 
-    // Applying texture
-    SDL_Rect * rect = init_rect(0,0,w,h);
-    SDL_RenderCopy(renderer, texture, NULL, rect); 
-    free(rect);
+// Mark the pixels of a tile on a boundary of the frame (compared with
+// their 4 neighbours).
+//
+// data: Iteration counts of the frame (one per pixel, WIDTH per row).
+// x: Abscissa of the top left corner of the tile.
+// y: Ordinate of the top left corner of the tile.
+// w: Width of the tile.
+// h: Height of the tile.
+void mark_tile(void * data, int x, int y, int w, int h)
+{
+    const float * values = data;
 
-    // Updates the display.
-    SDL_RenderPresent(renderer);
+    for (int j = y; j < y + h; j++)
+        for (int i = x; i < x + w; i++)
+        {
+            const float * v = values + j * WIDTH + i;
+            SUPERSAMPLES.marks[j * WIDTH + i] = (i > 0 && boundary(*v, v[-1]))
+                || (i < WIDTH - 1 && boundary(*v, v[1]))
+                || (j > 0 && boundary(*v, v[-WIDTH]))
+                || (j < HEIGHT - 1 && boundary(*v, v[WIDTH]));
+        }
 }
 
-// Event loop that calls the relevant event handler.
+// Compute the samples of supersampled pixels (tile function, the pixels
+// being laid out vertically).
 //
-// renderer: Renderer to draw on.
-void event_loop(SDL_Renderer* renderer)
+// data: Supersampled pixels.
+// x: Unused.
+// y: First supersampled pixel.
+// w: Unused.
+// h: Number of supersampled pixels.
+void sample_tile(void * data, int x, int y, int w, int h)
 {
-    // Draws the fractal
-    SDL_Surface * surface = SDL_CreateRGBSurface(0,WIDTH,HEIGHT,32,0,0,0,0);
-    draw(renderer, surface, WIDTH, HEIGHT);
+    struct supersamples * supersamples = data;
+    int side = supersamples->side;
+    double cx[SSAA_MAX * SSAA_MAX];
+    double cy[SSAA_MAX * SSAA_MAX];
+    (void) x;
+    (void) w;
 
-    // Creates a variable to get the events.
-    SDL_Event event;
+    // The frame will not be displayed.
+    if (app_cancelled())
+        return;
 
-    while (1)
+    long skipped = 0;
+    for (int k = y; k < y + h; k++)
     {
-        // Waits for an event.
-        SDL_WaitEvent(&event);
+        int pixel = supersamples->pixels[k];
+        double px = plane_x(pixel % WIDTH);
+        double py = plane_y(pixel / WIDTH);
+
+        // One sample at a random point of every cell of the pixel (the
+        // offsets are added to the center of the pixel, so that the samples
+        // do not depend on where the frame is in the image).
+        for (int j = 0; j < side; j++)
+            for (int i = 0; i < side; i++)
+            {
+                uint64_t r = rng_at(SSAA_SEED, (uint64_t) TOP * WIDTH + pixel, j * side + i);
+                double u = (double) (r >> 40) * 0x1p-24;
+                double v = (double) (r >> 16 & 0xffffff) * 0x1p-24;
+                cx[j * side + i] = px + ((i + u) / side - 0.5) * VIEW.dx;
+                cy[j * side + i] = py + ((j + v) / side - 0.5) * VIEW.dy;
+            }
+
+        skipped += mandelbrot_smooth(cx, cy, side * side, ITER,
+                supersamples->values + (size_t) k * side * side);
+    }
+    __atomic_fetch_add(&SKIPPED, skipped, __ATOMIC_RELAXED);
+}
+
+// Supersample the boundaries of the frame: the boundaries are marked on
+// the thread pool, gathered, then their samples are computed on the
+// thread pool.
+//
+// w: Width of the frame.
+// h: Height of the frame.
+// side: Side of the grid of samples of a pixel (1 to disable it).
+void supersample(int w, int h, int side)
+{
+    size_t size = (size_t) w * h;
+
+    SUPERSAMPLES.count = 0;
+    SUPERSAMPLES.side = side;
+    if (side <= 1)
+        return;
 
-        switch (event.type)
+    SUPERSAMPLES.marks = realloc(SUPERSAMPLES.marks, size);
+    SUPERSAMPLES.pixels = realloc(SUPERSAMPLES.pixels, size * sizeof(int));
+    if (!SUPERSAMPLES.marks || !SUPERSAMPLES.pixels)
+        errx(EXIT_FAILURE, "Unable to allocate the supersampled pixels");
+
+    render_tiles(w, h, mark_tile, COUNTS.values);
+    for (size_t i = 0; i < size; i++)
+        if (SUPERSAMPLES.marks[i])
+            SUPERSAMPLES.pixels[SUPERSAMPLES.count++] = (int) i;
+
+    if (SUPERSAMPLES.count == 0)
+        return;
+    SUPERSAMPLES.values = realloc(SUPERSAMPLES.values,
+            (size_t) SUPERSAMPLES.count * side * side * sizeof(float));
+    if (!SUPERSAMPLES.values)
+        errx(EXIT_FAILURE, "Unable to allocate the samples");
+
+    render_tiles(1, SUPERSAMPLES.count, sample_tile, &SUPERSAMPLES);
+}
+
+// Compute the frame on the thread pool and write it into the surface. The
+// iteration counts are only computed again when the size or the render
+// mode changed, and the samples when the anti-aliasing changed too:
+// another palette only recolors them.
+//
+// surface: Surface to draw on.
+// w: Width of the frame.
+// h: Height of the frame.
+// settings: Parameters of the frame.
+// Returns whether the iteration counts have been computed.
+int render(SDL_Surface * surface, int w, int h, const struct settings * settings)
+{
+    SKIPPED = 0;
+    FILLED = 0;
+    int computed = !COUNTS.valid || COUNTS.w != w || COUNTS.h != h || COUNTS.mode != settings->mode;
+    if (computed)
+    {
+        if ((size_t) COUNTS.w * COUNTS.h < (size_t) w * h)
         {
-            // If the "quit" button is pushed, ends the event loop.
-            case SDL_QUIT:
-                return;
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    WIDTH = event.window.data1;
-                    HEIGHT = event.window.data2;
-                    draw(renderer, surface, WIDTH, HEIGHT);
-                }
-                break;
+            COUNTS.values = realloc(COUNTS.values, (size_t) w * h * sizeof(float));
+            if (!COUNTS.values)
+                errx(EXIT_FAILURE, "Unable to allocate the iteration buffer");
         }
+        COUNTS.w = w;
+        COUNTS.h = h;
+        COUNTS.mode = settings->mode;
+        COUNTS.ssaa = 1;
+        SUPERSAMPLES.count = 0;
+        render_tiles(w, h, settings->mode == SUBDIVIDE ? subdivide_tile : render_tile, COUNTS.values);
+
+        // Some tiles of a cancelled frame have not been computed.
+        COUNTS.valid = !app_cancelled();
+    }
+
+    if (COUNTS.valid && COUNTS.ssaa != settings->ssaa)
+    {
+        supersample(w, h, settings->ssaa);
+        COUNTS.ssaa = settings->ssaa;
+        COUNTS.valid = !app_cancelled();
+        computed = 1;
     }
+
+    struct palette * palette = &PALETTES.list[settings->palette];
+    draw_pixels(surface, COUNTS.values, w, h, palette);
+    draw_supersamples(surface, w, h, palette);
+    return computed;
 }
 
-int main()
+// Compute the frame into the surface and report its time.
+//
+// renderer: Unused (the frame is written into the surface).
+// surface: Surface to draw on.
+// w: Current width of the window.
+// h: Current height of the window.
+// state: Parameters of the frame (snapshot of SETTINGS).
+void draw(SDL_Renderer * renderer, SDL_Surface * surface, int w, int h, const void * state)
+{
+    (void) renderer;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    const struct settings * settings = state;
+
+    WIDTH = w;
+    HEIGHT = h;
+    VIEW = (struct view) { -1.5, -1, 2.0 / w, 2.0 / h };
+    TOP = 0;
+    int computed = render(surface, w, h, settings);
+
+    // Reports the frame time
+    double ms = (double) (SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+    if (computed)
+        fprintf(stderr, "frame %dx%d, %s, %d iterations (%ld skipped, %ld pixels filled), "
+                "%dx%d samples on %.2f%% of the pixels: %.2f ms\n",
+                w, h, settings->mode == SUBDIVIDE ? "subdivide" : "brute", ITER, SKIPPED, FILLED,
+                settings->ssaa, settings->ssaa, 100.0 * SUPERSAMPLES.count / ((double) w * h), ms);
+    else
+        fprintf(stderr, "frame %dx%d recolored with %s: %.2f ms\n",
+                w, h, PALETTES.list[settings->palette].name, ms);
+}
+
+// Render the image of the headless mode in bands streamed to the output
+// file (see export.h), so that its memory only depends on its width. A band
+// is computed with a row of each of its neighbours, so that its boundaries
+// are anti-aliased like in a single frame.
+//
+// headless: Options of the headless mode.
+// Returns the exit status.
+int export_image(const struct headless * headless)
 {
-    // Initializes the SDL.
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    int w = headless->w;
+    int h = headless->h;
+    struct export export;
+
+    // The checkpoint of another image is discarded (the palette is
+    // identified by the hash of its gradient, a file may have been edited).
+    char key[256];
+    snprintf(key, sizeof(key), "mandelbrot %d %s ssaa %d palette %016llx", ITER,
+            SETTINGS.mode == SUBDIVIDE ? "subdivide" : "brute", SETTINGS.ssaa,
+            (unsigned long long) palette_hash(&PALETTES.list[SETTINGS.palette]));
+
+    SDL_Surface * surface = SDL_CreateRGBSurface(0, w, BAND + 2, 32, 0, 0, 0, 0);
+    if (!surface)
         errx(EXIT_FAILURE, "%s", SDL_GetError());
 
-    // Creates a window.
-    SDL_Window* window = SDL_CreateWindow("Mandelbrot", 0, 0, WIDTH, HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (window == NULL)
+    WIDTH = w;
+    VIEW = (struct view) { -1.5, -1, 2.0 / w, 2.0 / h };
+    for (int y = export_begin(&export, headless->out, w, h, key); y < h; y += BAND)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        int rows = h - y < BAND ? h - y : BAND;
+        int bottom = y + rows < h ? y + rows + 1 : h;
+        TOP = y > 0 ? y - 1 : 0;
+        HEIGHT = bottom - TOP;
+
+        // Every band is a new frame.
+        COUNTS.valid = 0;
+        render(surface, w, HEIGHT, &SETTINGS);
+        export_write(&export, surface, y - TOP, rows);
+
+        double ms = (double) (SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+        fprintf(stderr, "rows %d to %d of %d (%ld skipped, %ld pixels filled, %.2f%% supersampled): %.2f ms\n",
+                y, y + rows, h, SKIPPED, FILLED, 100.0 * SUPERSAMPLES.count / ((double) w * HEIGHT), ms);
+    }
+    export_end(&export);
+
+    SDL_FreeSurface(surface);
+    return EXIT_SUCCESS;
+}
+
+// Points of the border of a frame and their normalized iteration counts.
+struct border
+{
+    double * cx;
+    double * cy;
+    float * values;
+};
+
+// Compute the iterations of points of the border of a frame (tile
+// function, the points being laid out vertically).
+//
+// data: Border of the frame.
+// x: Unused.
+// y: First point.
+// w: Unused.
+// h: Number of points.
+void border_tile(void * data, int x, int y, int w, int h)
+{
+    struct border * border = data;
+    (void) x;
+    (void) w;
+
+    long skipped = mandelbrot_smooth(border->cx + y, border->cy + y, h, ITER, border->values + y);
+    __atomic_fetch_add(&SKIPPED, skipped, __ATOMIC_RELAXED);
+}
+
+// Whether the border of a frame is in the set, computed on the thread
+// pool. The Mandelbrot set is full (its complement is connected), so a
+// border in the set only encloses points of the set: the interior of the
+// frame is in the set too, the Mariani-Silver argument of subdivide().
+//
+// w: Width of the frame.
+// h: Height of the frame.
+int border_inside(int w, int h)
+{
+    int count = 2 * (w + h) - 4;
+    double * cx = malloc(count * sizeof(double));
+    double * cy = malloc(count * sizeof(double));
+    float * values = malloc(count * sizeof(float));
+    if (!cx || !cy || !values)
+        errx(EXIT_FAILURE, "Unable to allocate the border of the frame");
+
+    // The rows then the columns of the border.
+    int k = 0;
+    for (int i = 0; i < w; i++)
+    {
+        cx[k] = cx[k + 1] = plane_x(i);
+        cy[k++] = plane_y(0);
+        cy[k++] = plane_y(h - 1);
+    }
+    for (int j = 1; j < h - 1; j++)
+    {
+        cy[k] = cy[k + 1] = plane_y(j);
+        cx[k++] = plane_x(0);
+        cx[k++] = plane_x(w - 1);
+    }
+
+    struct border border = { cx, cy, values };
+    render_tiles(1, count, border_tile, &border);
+    int inside = 1;
+    for (int i = 0; i < count && inside; i++)
+        inside = values[i] >= ITER;
+
+    free(values);
+    free(cy);
+    free(cx);
+    return inside;
+}
+
+// Fill the surface with the color of the points of the set.
+//
+// surface: Surface to draw on (32 bits per pixel).
+// palette: Palette of the frame.
+void fill_set(SDL_Surface * surface, struct palette * palette)
+{
+    palette_map(palette, surface->format);
+
+    if (SDL_LockSurface(surface) != 0)
         errx(EXIT_FAILURE, "%s", SDL_GetError());
 
-    // Creates a renderer.
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == NULL)
+    for (int y = 0; y < surface->h; y++)
+    {
+        Uint32 * row = (Uint32 *) ((Uint8 *) surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; x++)
+            row[x] = palette->lut[PALETTE_SIZE];
+    }
+
+    SDL_UnlockSurface(surface);
+}
+
+// Render a tile of the pyramid, unless it is in the cache, then its 4
+// tiles of the next level. A tile is computed with a pixel of each of its
+// neighbours, so that the boundaries are anti-aliased across the tiles.
+// The tiles whose border is in the set are filled without computing them,
+// and so are their descendants. The tiles are rendered on the thread pool,
+// and stored by the writer of the pyramid while the next ones are rendered.
+//
+// There is no bound for the tiles outside the set (not implemented by
+// design): even the tiles outside the disk of radius 2, where every point
+// escapes at once, show the gradient of the normalized iteration counts,
+// so their pixels cannot be filled with a single color, and computing them
+// costs a few iterations per pixel anyway.
+//
+// pyramid: Pyramid.
+// surface: Surface to draw the tiles on (PYRAMID_TILE + 2 pixels wide and
+// high).
+// z: Level of the tile.
+// x: Column of the tile.
+// y: Row of the tile.
+// inside: Whether the tile is known to be in the set.
+void render_pyramid(struct pyramid * pyramid, SDL_Surface * surface, int z, int x, int y, int inside)
+{
+    // Every parameter of the pixels of the tile: the palette by the hash of
+    // its gradient, so that the tiles of an edited gradient file are
+    // rendered again.
+    char key[PYRAMID_KEY];
+    if (snprintf(key, sizeof(key), "mandelbrot %d %s ssaa %d palette %016llx tile %d %d/%d/%d",
+                ITER, SETTINGS.mode == SUBDIVIDE ? "subdivide" : "brute", SETTINGS.ssaa,
+                (unsigned long long) palette_hash(&PALETTES.list[SETTINGS.palette]),
+                PYRAMID_TILE, z, x, y) >= (int) sizeof(key))
+        errx(EXIT_FAILURE, "Parameters of the tile %d/%d/%d too long", z, x, y);
+
+    if (!pyramid_cached(pyramid, z, x, y, key))
+    {
+        double side = PYRAMID_SIDE / ((double) (1 << z) * PYRAMID_TILE);
+        WIDTH = HEIGHT = PYRAMID_TILE + 2;
+        VIEW = (struct view) {
+            PYRAMID_X + (double) x * PYRAMID_SIDE / (1 << z) - 0.5 * side,
+            PYRAMID_Y + (double) y * PYRAMID_SIDE / (1 << z) - 0.5 * side,
+            side, side };
+        TOP = 0;
+
+        inside = inside || border_inside(WIDTH, HEIGHT);
+        if (inside)
+        {
+            fill_set(surface, &PALETTES.list[SETTINGS.palette]);
+            INSIDE++;
+        }
+        else
+        {
+            // Every tile is a new frame.
+            COUNTS.valid = 0;
+            render(surface, WIDTH, HEIGHT, &SETTINGS);
+        }
+        pyramid_write(pyramid, z, x, y, key, surface, 1, 1);
+    }
+
+    if (z + 1 < LEVELS)
+        for (int j = 0; j < 2; j++)
+            for (int i = 0; i < 2; i++)
+                render_pyramid(pyramid, surface, z + 1, 2 * x + i, 2 * y + j, inside);
+}
+
+// Render the tile pyramid into its directory.
+//
+// Returns the exit status.
+int generate_pyramid(void)
+{
+    struct pyramid pyramid;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    SDL_Surface * surface = SDL_CreateRGBSurface(0, PYRAMID_TILE + 2, PYRAMID_TILE + 2, 32, 0, 0, 0, 0);
+    if (!surface)
         errx(EXIT_FAILURE, "%s", SDL_GetError());
 
-    // Dispatches the events.
-    event_loop(renderer);
+    pyramid_open(&pyramid, TILES);
+    render_pyramid(&pyramid, surface, 0, 0, 0, 0);
+    pyramid_close(&pyramid);
 
-    // Destroys the objects.
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    double ms = (double) (SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+    fprintf(stderr, "pyramid of %d levels in %s: %ld tiles rendered (%ld inside the set), %ld cached: %.2f ms\n",
+            LEVELS, TILES, pyramid.rendered, INSIDE, pyramid.cached, ms);
 
+    SDL_FreeSurface(surface);
     return EXIT_SUCCESS;
 }
+
+// The 'm' key switches the render mode, to compare them, the 'p' key
+// selects the next palette and the 'a' key switches the anti-aliasing.
+int event(const SDL_Event * event, int w, int h, void * state)
+{
+    struct settings * settings = state;
+    (void) w;
+    (void) h;
+
+    if (event->type != SDL_KEYDOWN)
+        return 0;
+
+    switch (event->key.keysym.sym)
+    {
+        case SDLK_m:
+            settings->mode = settings->mode == SUBDIVIDE ? BRUTE : SUBDIVIDE;
+            return 1;
+        case SDLK_p:
+            settings->palette = (settings->palette + 1) % PALETTES.count;
+            return 1;
+        case SDLK_a:
+            settings->ssaa = settings->ssaa > 1 ? 1 : SSAA;
+            return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    // Parses the options of the headless mode.
+    struct headless headless;
+    argc = headless_parse(&headless, argc, argv, WIDTH, HEIGHT);
+    argc = palette_parse(&PALETTES, &SETTINGS.palette, argc, argv);
+
+    // Parses the render mode and the anti-aliasing.
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc && strcmp(argv[i + 1], "brute") == 0)
+            SETTINGS.mode = BRUTE;
+        else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc
+                && strcmp(argv[i + 1], "subdivide") == 0)
+            SETTINGS.mode = SUBDIVIDE;
+        else if (strcmp(argv[i], "--ssaa") == 0 && i + 1 < argc)
+        {
+            char * end;
+            SSAA = (int) strtol(argv[i + 1], &end, 10);
+            if (*argv[i + 1] == '\0' || *end != '\0' || SSAA < 2 || SSAA > SSAA_MAX)
+                errx(EXIT_FAILURE, "Invalid anti-aliasing: %s (expected 2 to %d)", argv[i + 1], SSAA_MAX);
+            SETTINGS.ssaa = SSAA;
+        }
+        else if (strcmp(argv[i], "--band") == 0 && i + 1 < argc)
+        {
+            char * end;
+            BAND = (int) strtol(argv[i + 1], &end, 10);
+            if (*argv[i + 1] == '\0' || *end != '\0' || BAND < 1)
+                errx(EXIT_FAILURE, "Invalid band: %s (expected a number of rows)", argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc)
+            TILES = argv[i + 1];
+        else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc)
+        {
+            char * end;
+            LEVELS = (int) strtol(argv[i + 1], &end, 10);
+            if (*argv[i + 1] == '\0' || *end != '\0' || LEVELS < 1 || LEVELS > MAX_LEVELS)
+                errx(EXIT_FAILURE, "Invalid levels: %s (expected 1 to %d)", argv[i + 1], MAX_LEVELS);
+        }
+        else
+            errx(EXIT_FAILURE, "Usage: %s [--mode brute|subdivide] [--ssaa N] [--palette FILE] "
+                    "[--band ROWS] [--tiles DIR [--levels N]]", argv[0]);
+        i++;
+    }
+
+    // Selects the kernel and starts the render threads.
+    kernel_init();
+    tiles_init();
+
+    struct app app = { "Mandelbrot", WIDTH, HEIGHT, 1, draw, event, &SETTINGS, sizeof(SETTINGS) };
+    int status = TILES ? generate_pyramid()
+        : headless.enabled ? export_image(&headless) : app_run(&app, &headless);
+
+    free(COUNTS.values);
+    free(SUPERSAMPLES.marks);
+    free(SUPERSAMPLES.pixels);
+    free(SUPERSAMPLES.values);
+    tiles_quit();
+    return status;
+}
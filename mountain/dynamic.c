@@ -1,135 +1,101 @@
-#include <err.h>
 #include <stdlib.h>
-#include <time.h>
-#include <SDL2/SDL.h>
-
-#define MIN(a, b) ( ( (a) < (b) ) ? (a) : (b) )
+#include "app.h"
+#include "fractals.h"
+#include "present.h"
+#include "rng.h"
+#include "tiles.h"
+#include "curvecache.h"
 
 #define TOP_LEVEL 12
 
-// Recursive function that draws the fractal canopy.
+// Recursion level of the fractal.
+int LEVEL = 8;
+
+// Seed of the random displacements (--seed, the time by default).
+uint64_t SEED;
+
+// Vertices of the last generated mountain.
+struct points POINTS;
+
+// Vertices of every level drawn so far at the current window size.
+struct curve_cache CACHE;
+
+// Generates the vertices of the mountain of a level.
 //
-// renderer: Renderer to draw on.
-// x: Abscissa of the starting point of the segments.
-// y: Ordinate of the starting point of the segments.
-// len: Length of the segments.
-// a: Angle use to rotate the segments.
-// level: Recursion level (0 = first iteration).
-void v(SDL_Renderer* renderer, int x, int y, int z, int t, int level)
+// level: Recursion level.
+// w: Current width of the window.
+// h: Current height of the window.
+// out: Vertices of the mountain (2^level + 1).
+void generate(int level, int w, int h, struct fpoint * out)
 {
-    // Trace the mountain
-    if (level == 0)
-        SDL_RenderDrawLine(renderer, x, y, z, t);
-    // Divide the current segment into 2 parts.
-    else
+    points_clear(&POINTS);
+    mountain(&POINTS, w / 4, h/2, 3*w/4, h/2, level, SEED);
+    for (size_t i = 0; i < POINTS.len; i++)
     {
-        int h = (y+t)/2 + rand()%(abs(z-x)/5+20);
-        int m = (x+z)/2;
-        v(renderer, x, y, m, h, level-1);
-        v(renderer, m, h, z, t, level-1);
+        out[i].x = POINTS.data[i].x;
+        out[i].y = POINTS.data[i].y;
     }
 }
 
-// Initializes the renderer, draws the fractal canopy and updates the display.
+// Draws the mountain.
 //
 // renderer: Renderer to draw on.
+// surface: Unused (the mountain is drawn with the renderer).
 // w: Current width of the window.
 // h: Current height of the window.
-void draw(SDL_Renderer* renderer, int w, int h, int level)
+// state: Recursion level (snapshot of LEVEL).
+void draw(SDL_Renderer* renderer, SDL_Surface * surface, int w, int h, const void * state)
 {
+    (void) surface;
 
     // If the width or the height is too small, we do not draw anything.
     if (w < 20 || h < 20)
         return;
 
-    // Clears the renderer (sets the background to black).
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    // Sets the color for drawing operations to white.
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-
-    // Draws the fractal canopy. 
-    v(renderer, w / 4, h/2, 3*w/4, h/2, level > TOP_LEVEL ? TOP_LEVEL : level);
-
-    // Updates the display.
-    SDL_RenderPresent(renderer);
+    // Takes the mountain from the cache and draws it in a single call.
+    int level = *(const int *) state;
+    level = level > TOP_LEVEL ? TOP_LEVEL : level < 0 ? 0 : level;
+    draw_chunk(renderer, curve_cache_get(&CACHE, level, w, h), (1 << level) + 1);
 }
 
-// Event loop that calls the relevant event handler.
-//
-// renderer: Renderer to draw on.
-void event_loop(SDL_Renderer* renderer, int level)
+// The horizontal position of the mouse sets the level.
+int event(const SDL_Event * event, int w, int h, void * state)
 {
-    // Width and height of the window.
-    int w = 500;
-    int h = 500;
-    double ratio;
+    (void) h;
 
-    // Draws the fractal canopy (first draw).
-    draw(renderer, w, h, level);
+    if (event->type != SDL_MOUSEMOTION)
+        return 0;
 
-    // Creates a variable to get the events.
-    SDL_Event event;
+    // Nothing changes on screen while the level stays the same.
+    int * level = state;
+    double ratio = ((double) event->motion.x / (double) w) * (double) TOP_LEVEL;
+    if ((int) ratio == *level)
+        return 0;
 
-    while (1)
-    {
-        // Waits for an event.
-        SDL_WaitEvent(&event);
-
-        switch (event.type)
-        {
-            // If the "quit" button is pushed, ends the event loop.
-            case SDL_QUIT:
-                return;
-
-            // If the window is resized, updates and redraws the diagonals.
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    w = event.window.data1;
-                    h = event.window.data2;
-                    draw(renderer, w, h, level);
-                }
-                break;
-            case SDL_MOUSEMOTION:
-                ratio = ((double) event.motion.x / (double) w) * (double) TOP_LEVEL;
-                draw(renderer, w, h, (int) ratio);
-                break;
-        }
-    }
+    *level = (int) ratio;
+    return 1;
 }
 
 int main(int argc, char * argv[])
 {
-    // Randomize
-    srand(time(NULL));
-
-    // Initializes the SDL.
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    // Parses the options of the headless mode.
+    struct headless headless;
+    argc = headless_parse(&headless, argc, argv, 500, 500);
+    argc = rng_parse(&SEED, argc, argv);
 
-    // Creates a window.
-    SDL_Window* window = SDL_CreateWindow("Dynamic Mountain", 0, 0, 500, 500,
-            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (window == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    if (argc == 2)
+        LEVEL = atoi(argv[1]);
 
-    // Creates a renderer.
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    curve_cache_init(&CACHE, generate);
 
-    // Dispatches the events.
-    if (argc == 2)
-        event_loop(renderer, atoi(argv[1]));
-    else
-        event_loop(renderer, 8);
+    // The deepest levels are displaced on the tile pool.
+    tiles_init();
 
-    // Destroys the objects.
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    struct app app = { "Dynamic Mountain", 500, 500, 0, draw, event, &LEVEL, sizeof(LEVEL) };
+    int status = app_run(&app, &headless);
+    tiles_quit();
 
-    return EXIT_SUCCESS;
+    curve_cache_free(&CACHE);
+    points_free(&POINTS);
+    return status;
 }
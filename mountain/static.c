@@ -1,130 +1,60 @@
-#include <err.h>
 #include <stdlib.h>
-#include <time.h>
-#include <SDL2/SDL.h>
+#include "app.h"
+#include "fractals.h"
+#include "present.h"
+#include "rng.h"
+#include "tiles.h"
 
-#define MIN(a, b) ( ( (a) < (b) ) ? (a) : (b) )
+#define TOP_LEVEL 20
 
-#define TOP_LEVEL 12
+// Recursion level of the fractal.
+int LEVEL = 8;
 
-// Recursive function that draws the fractal canopy.
-//
-// renderer: Renderer to draw on.
-// x: Abscissa of the starting point of the segments.
-// y: Ordinate of the starting point of the segments.
-// len: Length of the segments.
-// a: Angle use to rotate the segments.
-// level: Recursion level (0 = first iteration).
-void v(SDL_Renderer* renderer, int x, int y, int z, int t, int level)
-{
-    // Trace the mountain
-    if (level == 0)
-        SDL_RenderDrawLine(renderer, x, y, z, t);
-    // Divide the current segment into 2 parts.
-    else
-    {
-        int h = (y+t)/2 + rand()%(abs(z-x)/5+20);
-        int m = (x+z)/2;
-        v(renderer, x, y, m, h, level-1);
-        v(renderer, m, h, z, t, level-1);
-    }
-}
+// Seed of the random displacements (--seed, the time by default).
+uint64_t SEED;
+
+// Vertices of the frame.
+struct points POINTS;
 
-// Initializes the renderer, draws the fractal canopy and updates the display.
+// Draws the mountain.
 //
 // renderer: Renderer to draw on.
+// surface: Unused (the mountain is drawn with the renderer).
 // w: Current width of the window.
 // h: Current height of the window.
-void draw(SDL_Renderer* renderer, int w, int h, int level)
+// state: Unused (the program has no events).
+void draw(SDL_Renderer* renderer, SDL_Surface * surface, int w, int h, const void * state)
 {
+    (void) surface;
+    (void) state;
 
     // If the width or the height is too small, we do not draw anything.
     if (w < 20 || h < 20)
         return;
 
-    // Clears the renderer (sets the background to black).
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    // Sets the color for drawing operations to white.
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-
-    // Draws the fractal canopy. 
-    v(renderer, w / 4, h/2, 3*w/4, h/2, level > TOP_LEVEL ? TOP_LEVEL : level);
-
-    // Updates the display.
-    SDL_RenderPresent(renderer);
-}
-
-// Event loop that calls the relevant event handler.
-//
-// renderer: Renderer to draw on.
-void event_loop(SDL_Renderer* renderer, int level)
-{
-    // Width and height of the window.
-    int w = 500;
-    int h = 500;
-
-    // Draws the fractal canopy (first draw).
-    draw(renderer, w, h, level);
-
-    // Creates a variable to get the events.
-    SDL_Event event;
-
-    while (1)
-    {
-        // Waits for an event.
-        SDL_WaitEvent(&event);
-
-        switch (event.type)
-        {
-            // If the "quit" button is pushed, ends the event loop.
-            case SDL_QUIT:
-                return;
-
-            // If the window is resized, updates and redraws the diagonals.
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    w = event.window.data1;
-                    h = event.window.data2;
-                    draw(renderer, w, h, level);
-                }
-                break;
-        }
-    }
+    // Generates and draws the fractal.
+    points_clear(&POINTS);
+    mountain(&POINTS, w / 4, h/2, 3*w/4, h/2, LEVEL > TOP_LEVEL ? TOP_LEVEL : LEVEL, SEED);
+    draw_polyline(renderer, &POINTS);
 }
 
 int main(int argc, char * argv[])
 {
-    // Randomize
-    srand(time(NULL));
-
-    // Initializes the SDL.
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
-
-    // Creates a window.
-    SDL_Window* window = SDL_CreateWindow("Static Mountain", 0, 0, 500, 500,
-            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (window == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
+    // Parses the options of the headless mode.
+    struct headless headless;
+    argc = headless_parse(&headless, argc, argv, 500, 500);
+    argc = rng_parse(&SEED, argc, argv);
 
-    // Creates a renderer.
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == NULL)
-        errx(EXIT_FAILURE, "%s", SDL_GetError());
-
-    // Dispatches the events.
     if (argc == 2)
-        event_loop(renderer, atoi(argv[1]));
-    else
-        event_loop(renderer, 8);
+        LEVEL = atoi(argv[1]);
+
+    // The deepest levels are displaced on the tile pool.
+    tiles_init();
 
-    // Destroys the objects.
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    struct app app = { "Static Mountain", 500, 500, 0, draw, NULL, NULL, 0 };
+    int status = app_run(&app, &headless);
+    tiles_quit();
 
-    return EXIT_SUCCESS;
+    points_free(&POINTS);
+    return status;
 }
@@ -0,0 +1,57 @@
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "image.h"
+#include "rng.h"
+#include "terrain.h"
+#include "tiles.h"
+
+// Largest heightmap generated in memory (1 GiB of heights): the larger ones
+// are streamed tile by tile.
+#define MAX_IN_MEMORY 16385
+
+int main(int argc, char * argv[])
+{
+    const char * out = NULL;
+    int size = 1025;
+    int streamed = 0;
+
+    // Parses the seed, then the options of the heightmap.
+    uint64_t seed;
+    argc = rng_parse(&seed, argc, argv);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out = argv[++i];
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stream") == 0)
+            streamed = 1;
+        else
+            out = NULL, i = argc;
+    }
+
+    if (out == NULL)
+        errx(EXIT_FAILURE, "Usage: %s --out FILE.pgm|FILE.raw [--size 2^n+1] [--seed N] [--stream]", argv[0]);
+    if (!has_extension(out, ".pgm") && !has_extension(out, ".raw"))
+        errx(EXIT_FAILURE, "Unsupported heightmap format: %s (expected .pgm or .raw)", out);
+    if (!terrain_valid_size(size))
+        errx(EXIT_FAILURE, "Invalid size of heightmap: %d (expected 2^n + 1)", size);
+
+    tiles_init();
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    terrain_export(out, size, seed, streamed || size > MAX_IN_MEMORY);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    tiles_quit();
+
+    double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    fprintf(stderr, "heightmap %dx%d, seed %llu, %s: %.2f ms\n", size, size,
+            (unsigned long long) seed, streamed || size > MAX_IN_MEMORY ? "streamed" : "in memory", ms);
+    return EXIT_SUCCESS;
+}